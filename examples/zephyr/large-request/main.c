@@ -15,21 +15,17 @@
 #include "blecon/blecon_error.h"
 #include "blecon_zephyr/blecon_zephyr.h"
 #include "blecon_zephyr/blecon_zephyr_event_loop.h"
+#include "blecon_zephyr/blecon_zephyr_request_writer.h"
 
-#define CONCURRENT_SEND_OPS_COUNT 2
-
-struct example_send_op_t {
-    struct blecon_request_send_data_op_t op;
-    bool busy;
-};
+#define CHUNK_SZ 4096
 
 static struct blecon_event_loop_t* _event_loop = NULL;
 static struct blecon_t _blecon = {0};
 static struct blecon_request_t _request = {0};
-static struct example_send_op_t _send_ops[CONCURRENT_SEND_OPS_COUNT] = {0};
+static struct blecon_zephyr_request_writer_t _writer = {0};
 static struct blecon_request_receive_data_op_t _receive_op = {0};
-static uint8_t _outgoing_data_buffer[CONFIG_LARGE_REQUEST_EXAMPLE_BUFFER_SZ] = {0}; // Large buffer
-static size_t _outgoing_data_buffer_pos = 0;
+static uint8_t _writer_buffer[CONFIG_BLECON_REQUEST_WRITER_MAX_OPS_IN_FLIGHT * CHUNK_SZ] = {0};
+static size_t _outgoing_data_pos = 0;
 static uint8_t _incoming_data_buffer[64] = {0};
 
 // Blecon callbacks
@@ -47,19 +43,23 @@ const static struct blecon_callbacks_t blecon_callbacks = {
 
 // Requests callbacks
 static void example_request_on_closed(struct blecon_request_t* request);
-static void example_request_on_data_sent(struct blecon_request_send_data_op_t* send_data_op, bool data_sent);
 static uint8_t* example_request_alloc_incoming_data_buffer(struct blecon_request_receive_data_op_t* receive_data_op, size_t sz);
 static void example_request_on_data_received(struct blecon_request_receive_data_op_t* receive_data_op, bool data_received, const uint8_t* data, size_t sz, bool finished);
 
 const static struct blecon_request_callbacks_t blecon_request_callbacks = {
     .on_closed = example_request_on_closed,
-    .on_data_sent = example_request_on_data_sent,
     .alloc_incoming_data_buffer = example_request_alloc_incoming_data_buffer,
     .on_data_received = example_request_on_data_received
 };
 
-// Internal functions
-static void example_send_data(void);
+// Request writer callbacks
+static size_t example_writer_on_read(struct blecon_zephyr_request_writer_t* writer, uint8_t* data, size_t max_sz, bool* finished);
+static void example_writer_on_done(struct blecon_zephyr_request_writer_t* writer, bool success);
+
+const static struct blecon_zephyr_request_writer_callbacks_t writer_callbacks = {
+    .on_read = example_writer_on_read,
+    .on_done = example_writer_on_done
+};
 
 // Shell commands
 static int cmd_blecon_connection_initiate(const struct shell* sh, size_t argc, char** argv);
@@ -82,16 +82,11 @@ static void send_data(struct blecon_t* blecon) {
     // Clean-up request
     blecon_request_cleanup(&_request);
     
-    // Reset outgoing buffer position
-    _outgoing_data_buffer_pos = 0;
+    // Reset outgoing data position
+    _outgoing_data_pos = 0;
 
-    // Reset send operations
-    for(size_t p = 0; p < CONCURRENT_SEND_OPS_COUNT; p++) {
-        _send_ops[p].busy = false;
-    }
-    
     // Queue initial send operations
-    example_send_data();
+    blecon_zephyr_request_writer_start(&_writer);
 
     // Create receive data operation
     if(!blecon_request_receive_data(&_receive_op, &_request, NULL)) {
@@ -131,21 +126,6 @@ void example_request_on_data_received(struct blecon_request_receive_data_op_t* r
     }
 }
 
-void example_request_on_data_sent(struct blecon_request_send_data_op_t* send_data_op, bool data_sent) {
-    // Mark send operation as not busy
-    struct example_send_op_t* op = (struct example_send_op_t*)blecon_request_send_data_op_get_user_data(send_data_op);
-    op->busy = false;
-
-    if(!data_sent) {
-        printk("Failed to send data\r\n");
-        return;
-    }
-    printk("Data sent\r\n");
-
-    // Send more chunks if needed
-    example_send_data();
-}
-
 uint8_t* example_request_alloc_incoming_data_buffer(struct blecon_request_receive_data_op_t* receive_data_op, size_t sz) {
     return _incoming_data_buffer;
 }
@@ -163,45 +143,27 @@ void example_request_on_closed(struct blecon_request_t* request) {
     blecon_connection_terminate(&_blecon);
 }
 
-void example_send_data(void) {
-    for(size_t p = 0; p < CONCURRENT_SEND_OPS_COUNT; p++) {
-        struct example_send_op_t* op = &_send_ops[p];
-        if(op->busy) {
-            continue;
-        }
-        op->busy = true;
-
-        if(_outgoing_data_buffer_pos >= sizeof(_outgoing_data_buffer)) {
-            // Already finished
-            break;
-        }
-
-        size_t chunk_sz = 4096;
-        if(_outgoing_data_buffer_pos + chunk_sz > sizeof(_outgoing_data_buffer)) {
-            chunk_sz = sizeof(_outgoing_data_buffer) - _outgoing_data_buffer_pos;
-        }
-
-        bool finished = false;
-        if(_outgoing_data_buffer_pos + chunk_sz >= sizeof(_outgoing_data_buffer)) {
-            finished = true;
-        }
-
-        printk("Sending chunk of %u bytes\r\n", chunk_sz);
-
-        // Create send data operation
-        if(!blecon_request_send_data(&op->op, &_request, _outgoing_data_buffer + _outgoing_data_buffer_pos, chunk_sz, finished, op)) {
-            printk("Failed to send data\r\n");
-            blecon_request_cleanup(&_request);
-            return;
-        }
+size_t example_writer_on_read(struct blecon_zephyr_request_writer_t* writer, uint8_t* data, size_t max_sz, bool* finished) {
+    // Generate a known pattern
+    size_t sz = CONFIG_LARGE_REQUEST_EXAMPLE_BUFFER_SZ - _outgoing_data_pos;
+    if(sz > max_sz) {
+        sz = max_sz;
+    }
+    for(size_t p = 0; p < sz; p++) {
+        data[p] = (uint8_t)(_outgoing_data_pos + p);
+    }
+    _outgoing_data_pos += sz;
 
-        _outgoing_data_buffer_pos += chunk_sz;
+    *finished = (_outgoing_data_pos >= CONFIG_LARGE_REQUEST_EXAMPLE_BUFFER_SZ);
+    return sz;
+}
 
-        if(finished) {
-            printk("All sent\r\n");
-            break;
-        }
+void example_writer_on_done(struct blecon_zephyr_request_writer_t* writer, bool success) {
+    if(!success) {
+        printk("Failed to send data\r\n");
+        return;
     }
+    printk("All sent\r\n");
 }
 
 int main(void)
@@ -211,11 +173,6 @@ int main(void)
     k_sleep(K_MSEC(1000));
 #endif
 
-    // Set up the _outgoing_data_buffer with a known pattern
-    for(size_t p = 0; p < sizeof(_outgoing_data_buffer); p++) {
-        _outgoing_data_buffer[p] = (uint8_t)p;
-    }
-
     // Get event loop
     _event_loop = blecon_zephyr_get_event_loop();
 
@@ -246,7 +203,7 @@ int main(void)
         .callbacks = &blecon_request_callbacks,
         .user_data = NULL
     };
-    blecon_request_init(&_request, &request_params);
+    blecon_zephyr_request_writer_init(&_writer, &_request, &request_params, _writer_buffer, sizeof(_writer_buffer), CHUNK_SZ, &writer_callbacks, NULL);
 
     // Print device URL
     char blecon_url[BLECON_URL_SZ] = {0};
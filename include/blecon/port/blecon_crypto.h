@@ -19,6 +19,7 @@ extern "C" {
 // Security
 struct blecon_crypto_t;
 struct blecon_crypto_aead_cipher_t;
+struct blecon_crypto_sha256_t;
 
 struct blecon_crypto_fn_t {
     void (*setup)(struct blecon_crypto_t* crypto);
@@ -41,6 +42,23 @@ struct blecon_crypto_fn_t {
     void (*aead_cipher_free)(struct blecon_crypto_aead_cipher_t* cipher);
     void (*sha256_compute)(struct blecon_crypto_t* crypto, const uint8_t* in, size_t in_sz, uint8_t* hash);
     bool (*sha256_verify)(struct blecon_crypto_t* crypto, const uint8_t* in, size_t in_sz, const uint8_t* hash);
+
+    // In-place variants: data holds the plaintext followed by BLECON_CHACHA20_POLY1305_TAG_SZ bytes of room for the tag
+    // (e.g. reserved with blecon_buffer_stack()), and the ciphertext and tag overwrite it
+    void (*aead_cipher_enc_auth_in_place)(struct blecon_crypto_aead_cipher_t* cipher, 
+                const uint8_t* nonce, size_t nonce_sz, 
+                uint8_t* data, size_t plaintext_sz, 
+                const uint8_t* additional_data, size_t additional_data_sz);
+    bool (*aead_cipher_dec_auth_in_place)(struct blecon_crypto_aead_cipher_t* cipher, 
+                const uint8_t* nonce, size_t nonce_sz, 
+                uint8_t* data, size_t ciphertext_mac_sz,
+                const uint8_t* additional_data, size_t additional_data_sz);
+
+    // Incremental hashing: sha256_finish() writes the hash and frees the object, sha256_free() abandons the hash
+    struct blecon_crypto_sha256_t* (*sha256_new)(struct blecon_crypto_t* crypto);
+    void (*sha256_update)(struct blecon_crypto_sha256_t* sha256, const uint8_t* in, size_t in_sz);
+    void (*sha256_finish)(struct blecon_crypto_sha256_t* sha256, uint8_t* hash);
+    void (*sha256_free)(struct blecon_crypto_sha256_t* sha256);
 };
 
 struct blecon_crypto_t {
@@ -51,6 +69,10 @@ struct blecon_crypto_aead_cipher_t {
     struct blecon_crypto_t* crypto;
 };
 
+struct blecon_crypto_sha256_t {
+    struct blecon_crypto_t* crypto;
+};
+
 static inline void blecon_crypto_init(struct blecon_crypto_t* crypto, const struct blecon_crypto_fn_t* fns) {
     crypto->fns = fns;
 }
@@ -107,6 +129,22 @@ static inline bool blecon_crypto_aead_cipher_dec_auth(struct blecon_crypto_aead_
                     plaintext);
             }
 
+static inline void blecon_crypto_aead_cipher_enc_auth_in_place(struct blecon_crypto_aead_cipher_t* cipher, 
+            const uint8_t* nonce, size_t nonce_sz, 
+            uint8_t* data, size_t plaintext_sz, 
+            const uint8_t* additional_data, size_t additional_data_sz) {
+                cipher->crypto->fns->aead_cipher_enc_auth_in_place(cipher, nonce, nonce_sz, data, plaintext_sz, 
+                    additional_data, additional_data_sz);
+            }
+
+static inline bool blecon_crypto_aead_cipher_dec_auth_in_place(struct blecon_crypto_aead_cipher_t* cipher, 
+            const uint8_t* nonce, size_t nonce_sz, 
+            uint8_t* data, size_t ciphertext_mac_sz,
+            const uint8_t* additional_data, size_t additional_data_sz) {
+                return cipher->crypto->fns->aead_cipher_dec_auth_in_place(cipher, nonce, nonce_sz, data, ciphertext_mac_sz, 
+                    additional_data, additional_data_sz);
+            }
+
 static inline void blecon_crypto_aead_cipher_free(struct blecon_crypto_aead_cipher_t* cipher) {
     cipher->crypto->fns->aead_cipher_free(cipher);
 }
@@ -119,6 +157,26 @@ static inline bool blecon_crypto_sha256_verify(struct blecon_crypto_t* crypto, c
     return crypto->fns->sha256_verify(crypto, in, in_sz, hash);
 }
 
+static inline void blecon_crypto_sha256_init(struct blecon_crypto_sha256_t* sha256, struct blecon_crypto_t* crypto) {
+    sha256->crypto = crypto;
+}
+
+static inline struct blecon_crypto_sha256_t* blecon_crypto_sha256_new(struct blecon_crypto_t* crypto) {
+    return crypto->fns->sha256_new(crypto);
+}
+
+static inline void blecon_crypto_sha256_update(struct blecon_crypto_sha256_t* sha256, const uint8_t* in, size_t in_sz) {
+    sha256->crypto->fns->sha256_update(sha256, in, in_sz);
+}
+
+static inline void blecon_crypto_sha256_finish(struct blecon_crypto_sha256_t* sha256, uint8_t* hash) {
+    sha256->crypto->fns->sha256_finish(sha256, hash);
+}
+
+static inline void blecon_crypto_sha256_free(struct blecon_crypto_sha256_t* sha256) {
+    sha256->crypto->fns->sha256_free(sha256);
+}
+
 #ifdef __cplusplus
 }
 #endif
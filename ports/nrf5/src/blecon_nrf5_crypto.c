@@ -11,6 +11,8 @@
 #include "nrf_crypto.h"
 #include "app_error.h"
 
+#define BLECON_NRF5_CRYPTO_RANDOM_POOL_SZ 64
+
 // Validate nRF5 SDK Config
 #if NRF_CRYPTO_ENABLED != 1
 #error "NRF_CRYPTO_ENABLED must be set to 1 in sdk_config.h"
@@ -48,12 +50,33 @@ static bool blecon_nrf5_crypto_aead_cipher_dec_auth(struct blecon_crypto_aead_ci
             const uint8_t* ciphertext_mac, size_t ciphertext_mac_sz,
             const uint8_t* additional_data, size_t additional_data_sz,
             uint8_t* plaintext);
+static void blecon_nrf5_crypto_aead_cipher_enc_auth_in_place(struct blecon_crypto_aead_cipher_t* cipher, 
+            const uint8_t* nonce, size_t nonce_sz, 
+            uint8_t* data, size_t plaintext_sz, 
+            const uint8_t* additional_data, size_t additional_data_sz);
+static bool blecon_nrf5_crypto_aead_cipher_dec_auth_in_place(struct blecon_crypto_aead_cipher_t* cipher, 
+            const uint8_t* nonce, size_t nonce_sz, 
+            uint8_t* data, size_t ciphertext_mac_sz,
+            const uint8_t* additional_data, size_t additional_data_sz);
 static void blecon_nrf5_crypto_aead_cipher_free(struct blecon_crypto_aead_cipher_t* cipher);
 static void blecon_nrf5_crypto_sha256_compute(struct blecon_crypto_t* crypto, const uint8_t* in, size_t in_sz, uint8_t* hash);
 static bool blecon_nrf5_crypto_sha256_verify(struct blecon_crypto_t* crypto, const uint8_t* in, size_t in_sz, const uint8_t* hash);
+static struct blecon_crypto_sha256_t* blecon_nrf5_crypto_sha256_new(struct blecon_crypto_t* crypto);
+static void blecon_nrf5_crypto_sha256_update(struct blecon_crypto_sha256_t* sha256, const uint8_t* in, size_t in_sz);
+static void blecon_nrf5_crypto_sha256_finish(struct blecon_crypto_sha256_t* sha256, uint8_t* hash);
+static void blecon_nrf5_crypto_sha256_free(struct blecon_crypto_sha256_t* sha256);
+
+struct blecon_nrf5_sha256_t {
+    struct blecon_crypto_sha256_t sha256;
+    nrf_crypto_hash_context_t ctx;
+};
 
 static struct blecon_crypto_t _crypto;
 
+// Small requests are served from a pool filled from the RNG in a single call
+static uint8_t _random_pool[BLECON_NRF5_CRYPTO_RANDOM_POOL_SZ];
+static size_t _random_pool_pos = BLECON_NRF5_CRYPTO_RANDOM_POOL_SZ;
+
 struct blecon_crypto_t* blecon_nrf5_crypto_init(void) {
     static const struct blecon_crypto_fn_t crypto_fn = {
         .setup = blecon_nrf5_crypto_setup,
@@ -67,7 +90,13 @@ struct blecon_crypto_t* blecon_nrf5_crypto_init(void) {
         .aead_cipher_dec_auth = blecon_nrf5_crypto_aead_cipher_dec_auth,
         .aead_cipher_free = blecon_nrf5_crypto_aead_cipher_free,
         .sha256_compute = blecon_nrf5_crypto_sha256_compute,
-        .sha256_verify = blecon_nrf5_crypto_sha256_verify
+        .sha256_verify = blecon_nrf5_crypto_sha256_verify,
+        .aead_cipher_enc_auth_in_place = blecon_nrf5_crypto_aead_cipher_enc_auth_in_place,
+        .aead_cipher_dec_auth_in_place = blecon_nrf5_crypto_aead_cipher_dec_auth_in_place,
+        .sha256_new = blecon_nrf5_crypto_sha256_new,
+        .sha256_update = blecon_nrf5_crypto_sha256_update,
+        .sha256_finish = blecon_nrf5_crypto_sha256_finish,
+        .sha256_free = blecon_nrf5_crypto_sha256_free
     };
 
     blecon_crypto_init(&_crypto, &crypto_fn);
@@ -89,15 +118,39 @@ void blecon_nrf5_crypto_setup(struct blecon_crypto_t* crypto) {
 }
 
 void blecon_nrf5_crypto_get_random(struct blecon_crypto_t* crypto, uint8_t* random, size_t sz) {
+    if(sz <= BLECON_NRF5_CRYPTO_RANDOM_POOL_SZ) {
+        while(sz > 0) {
+            if(_random_pool_pos == BLECON_NRF5_CRYPTO_RANDOM_POOL_SZ) {
+                ret_code_t ret_val = nrf_crypto_rng_vector_generate(_random_pool, BLECON_NRF5_CRYPTO_RANDOM_POOL_SZ);
+                blecon_assert(ret_val == NRF_SUCCESS);
+                _random_pool_pos = 0;
+            }
+
+            size_t chunk_sz = BLECON_NRF5_CRYPTO_RANDOM_POOL_SZ - _random_pool_pos;
+            if(chunk_sz > sz) {
+                chunk_sz = sz;
+            }
+            memcpy(random, &_random_pool[_random_pool_pos], chunk_sz);
+            memset(&_random_pool[_random_pool_pos], 0, chunk_sz); // Never hand out the same bytes twice
+            _random_pool_pos += chunk_sz;
+            random += chunk_sz;
+            sz -= chunk_sz;
+        }
+        return;
+    }
+
     ret_code_t ret_val = nrf_crypto_rng_vector_generate(random, sz);
     blecon_assert(ret_val == NRF_SUCCESS);
 }
 
 uint32_t blecon_nrf5_crypto_get_random_integer(struct blecon_crypto_t* crypto, uint32_t max) {
+    // Rejection sampling, to avoid the modulo bias: discard values below 2^32 mod max
+    uint32_t threshold = (uint32_t)(-max) % max;
     uint32_t result = 0;
-    blecon_nrf5_crypto_get_random(crypto, (uint8_t*)&result, sizeof(uint32_t));
-    result %= max;
-    return result;
+    do {
+        blecon_nrf5_crypto_get_random(crypto, (uint8_t*)&result, sizeof(uint32_t));
+    } while(result < threshold);
+    return result % max;
 }
 
 bool blecon_nrf5_crypto_generate_x25519_keypair(struct blecon_crypto_t* crypto, uint8_t* private_key, uint8_t* public_key) {
@@ -242,6 +295,50 @@ bool blecon_nrf5_crypto_aead_cipher_dec_auth(struct blecon_crypto_aead_cipher_t*
                 return ret_val == NRF_SUCCESS;
             }
 
+void blecon_nrf5_crypto_aead_cipher_enc_auth_in_place(struct blecon_crypto_aead_cipher_t* cipher, 
+            const uint8_t* nonce, size_t nonce_sz, 
+            uint8_t* data, size_t plaintext_sz, 
+            const uint8_t* additional_data, size_t additional_data_sz) {
+    if(plaintext_sz == 0) {
+        // Only the tag is written
+        blecon_nrf5_crypto_aead_cipher_enc_auth(cipher, nonce, nonce_sz, data, 0, additional_data, additional_data_sz, data);
+        return;
+    }
+
+    // nrf_crypto doesn't document that its input and output buffers may overlap, so encrypt from a copy
+    uint8_t* plaintext = BLECON_ALLOC(plaintext_sz);
+    if(plaintext == NULL) {
+        blecon_fatal_error();
+    }
+    memcpy(plaintext, data, plaintext_sz);
+
+    blecon_nrf5_crypto_aead_cipher_enc_auth(cipher, nonce, nonce_sz, plaintext, plaintext_sz, additional_data, additional_data_sz, data);
+
+    memset(plaintext, 0, plaintext_sz);
+    BLECON_FREE(plaintext);
+}
+
+bool blecon_nrf5_crypto_aead_cipher_dec_auth_in_place(struct blecon_crypto_aead_cipher_t* cipher, 
+            const uint8_t* nonce, size_t nonce_sz, 
+            uint8_t* data, size_t ciphertext_mac_sz,
+            const uint8_t* additional_data, size_t additional_data_sz) {
+    if(ciphertext_mac_sz < BLECON_CHACHA20_POLY1305_TAG_SZ) {
+        return false;
+    }
+
+    // nrf_crypto doesn't document that its input and output buffers may overlap, so decrypt from a copy
+    uint8_t* ciphertext_mac = BLECON_ALLOC(ciphertext_mac_sz);
+    if(ciphertext_mac == NULL) {
+        blecon_fatal_error();
+    }
+    memcpy(ciphertext_mac, data, ciphertext_mac_sz);
+
+    bool success = blecon_nrf5_crypto_aead_cipher_dec_auth(cipher, nonce, nonce_sz, ciphertext_mac, ciphertext_mac_sz, additional_data, additional_data_sz, data);
+
+    BLECON_FREE(ciphertext_mac);
+    return success;
+}
+
 void blecon_nrf5_crypto_aead_cipher_free(struct blecon_crypto_aead_cipher_t* cipher) {
     struct blecon_nrf5_aead_cipher_t* nrf5_cipher = (struct blecon_nrf5_aead_cipher_t*) cipher;
 
@@ -264,3 +361,35 @@ bool blecon_nrf5_crypto_sha256_verify(struct blecon_crypto_t* crypto, const uint
     blecon_nrf5_crypto_sha256_compute(crypto, in, in_sz, computed_hash);
     return memcmp(hash, computed_hash, BLECON_SHA256_HASH_SZ) == 0;
 }
+
+struct blecon_crypto_sha256_t* blecon_nrf5_crypto_sha256_new(struct blecon_crypto_t* crypto) {
+    struct blecon_nrf5_sha256_t* nrf5_sha256 = BLECON_ALLOC(sizeof(struct blecon_nrf5_sha256_t));
+    if(nrf5_sha256 == NULL) {
+        blecon_fatal_error();
+    }
+    blecon_crypto_sha256_init(&nrf5_sha256->sha256, crypto);
+    ret_code_t ret_val = nrf_crypto_hash_init(&nrf5_sha256->ctx, &g_nrf_crypto_hash_sha256_info);
+    blecon_assert(ret_val == NRF_SUCCESS);
+    return &nrf5_sha256->sha256;
+}
+
+void blecon_nrf5_crypto_sha256_update(struct blecon_crypto_sha256_t* sha256, const uint8_t* in, size_t in_sz) {
+    struct blecon_nrf5_sha256_t* nrf5_sha256 = (struct blecon_nrf5_sha256_t*) sha256;
+    ret_code_t ret_val = nrf_crypto_hash_update(&nrf5_sha256->ctx, in, in_sz);
+    blecon_assert(ret_val == NRF_SUCCESS);
+}
+
+void blecon_nrf5_crypto_sha256_finish(struct blecon_crypto_sha256_t* sha256, uint8_t* hash) {
+    struct blecon_nrf5_sha256_t* nrf5_sha256 = (struct blecon_nrf5_sha256_t*) sha256;
+    size_t hash_sz = BLECON_SHA256_HASH_SZ;
+    ret_code_t ret_val = nrf_crypto_hash_finalize(&nrf5_sha256->ctx, hash, &hash_sz);
+    blecon_assert(ret_val == NRF_SUCCESS);
+    blecon_assert(hash_sz == BLECON_SHA256_HASH_SZ);
+
+    BLECON_FREE(nrf5_sha256);
+}
+
+void blecon_nrf5_crypto_sha256_free(struct blecon_crypto_sha256_t* sha256) {
+    // The context holds no other resources
+    BLECON_FREE(sha256);
+}
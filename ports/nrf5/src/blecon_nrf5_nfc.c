@@ -44,7 +44,12 @@ struct blecon_nfc_t* blecon_nrf5_nfc_init(void) {
 
 static void nfc_callback(void * p_context, nfc_t2t_event_t event, const uint8_t * p_data, size_t data_length);
 static uint8_t _ndef_buffer[256];
+static size_t _ndef_sz;
+static uint8_t _message[256];
+static size_t _message_sz;
 static bool _nfc_active;
+static blecon_nrf5_nfc_field_on_callback_t _field_on_callback;
+static void* _field_on_user_data;
 
 #define URI_PREFIX "https://"
 
@@ -54,10 +59,24 @@ void blecon_nrf5_nfc_setup(struct blecon_nfc_t* nfc) {
         blecon_fatal_error();
     }
 
+    _ndef_sz = 0;
+    _message_sz = 0;
     _nfc_active = false;
 }
 
 void blecon_nrf5_nfc_set_message(struct blecon_nfc_t* nfc, const uint8_t* nfc_data, size_t nfc_data_sz) {
+    // The NDEF message is only encoded when the URI changes
+    if((_ndef_sz > 0) && (_message_sz == nfc_data_sz) && (memcmp(_message, nfc_data, nfc_data_sz) == 0)) {
+        return;
+    }
+
+    if(nfc_data_sz > sizeof(_message)) {
+        blecon_fatal_error();
+    }
+    memcpy(_message, nfc_data, nfc_data_sz);
+    _message_sz = nfc_data_sz;
+    _ndef_sz = 0;
+
     bool nfc_active = _nfc_active;
     if(nfc_active) {
         blecon_nrf5_nfc_stop(nfc);
@@ -85,6 +104,7 @@ void blecon_nrf5_nfc_set_message(struct blecon_nfc_t* nfc, const uint8_t* nfc_da
     if(ret != NRF_SUCCESS) {
         blecon_fatal_error();
     }
+    _ndef_sz = len;
 
     if(nfc_active) {
         blecon_nrf5_nfc_start(&_nfc);
@@ -109,12 +129,26 @@ void blecon_nrf5_nfc_stop(struct blecon_nfc_t* nfc) {
     _nfc_active = false;
 }
 
+void blecon_nrf5_nfc_set_field_on_callback(struct blecon_nfc_t* nfc, blecon_nrf5_nfc_field_on_callback_t callback, void* user_data) {
+    _field_on_callback = callback;
+    _field_on_user_data = user_data;
+}
+
+const uint8_t* blecon_nrf5_nfc_get_ndef_message(struct blecon_nfc_t* nfc, size_t* sz) {
+    *sz = _ndef_sz;
+    return (_ndef_sz > 0) ? _ndef_buffer : NULL;
+}
+
 // Private functions
 void nfc_callback(void * p_context, nfc_t2t_event_t event, const uint8_t * p_data, size_t data_length) {
     (void)p_context;
-    (void)event;
     (void)p_data;
     (void)data_length;
+
+    blecon_nrf5_nfc_field_on_callback_t callback = _field_on_callback;
+    if((event == NFC_T2T_EVENT_FIELD_ON) && (callback != NULL)) {
+        callback(&_nfc, _field_on_user_data);
+    }
 }
 
 #else
@@ -123,5 +157,10 @@ void blecon_nrf5_nfc_setup(struct blecon_nfc_t* nfc) {}
 void blecon_nrf5_nfc_set_message(struct blecon_nfc_t* nfc, const uint8_t* nfc_data, size_t nfc_data_sz) {}
 void blecon_nrf5_nfc_start(struct blecon_nfc_t* nfc) {}
 void blecon_nrf5_nfc_stop(struct blecon_nfc_t* nfc) {}
+void blecon_nrf5_nfc_set_field_on_callback(struct blecon_nfc_t* nfc, blecon_nrf5_nfc_field_on_callback_t callback, void* user_data) {}
+const uint8_t* blecon_nrf5_nfc_get_ndef_message(struct blecon_nfc_t* nfc, size_t* sz) {
+    *sz = 0;
+    return NULL;
+}
 
 #endif
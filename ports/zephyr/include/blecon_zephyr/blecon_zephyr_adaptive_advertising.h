@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) Blecon Ltd
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <zephyr/kernel.h>
+
+#include "blecon/blecon.h"
+#include "blecon/blecon_advertising_mode.h"
+#include "blecon/port/blecon_event_loop.h"
+
+/**
+ * @brief A step of the decay curve
+ */
+struct blecon_zephyr_adaptive_advertising_step_t {
+    /** The advertising mode to use */
+    enum blecon_advertising_mode_t mode;
+
+    /** How long to stay in this mode before moving to the next step, in milliseconds */
+    uint32_t duration_ms;
+};
+
+/**
+ * @brief Structure representing an adaptive advertising policy
+ *
+ * Switches to high performance advertising as soon as work is pending (requests queued or a connection initiated),
+ * then, once the work is done, steps through a decay curve before settling in the idle mode.
+ *
+ * Work is notified by the application, or by the connection linger, request batcher and outbox helpers once the policy
+ * has been attached to them with their set_adaptive_advertising() functions. Other helpers, such as upload sessions and
+ * scan uploaders, don't notify the policy: the application must call blecon_zephyr_adaptive_advertising_work_pending()
+ * and blecon_zephyr_adaptive_advertising_work_done() around their use.
+ *
+ * The time it takes to connect while work is pending is tracked as a moving average. When hotspots connect faster
+ * than the reference latency, the decay curve is shortened proportionally (down to a quarter of its length).
+ */
+struct blecon_zephyr_adaptive_advertising_t {
+    /** The Blecon instance */
+    struct blecon_t* blecon;
+
+    /** The decay curve */
+    const struct blecon_zephyr_adaptive_advertising_step_t* steps;
+
+    /** Number of steps in the decay curve */
+    size_t steps_count;
+
+    /** The mode to use once the decay curve has completed */
+    enum blecon_advertising_mode_t idle_mode;
+
+    /** The mode currently set */
+    enum blecon_advertising_mode_t current_mode;
+
+    /** Flag indicating if current_mode has been applied; mode changes which Blecon rejects are retried on the next step */
+    bool mode_set;
+
+    /** Index of the current step, or steps_count once idle */
+    size_t step;
+
+    /** Number of work_pending() calls not yet balanced by a work_done() call */
+    size_t work_pending_count;
+
+    /** Flag indicating if a connection is being waited for */
+    bool connecting;
+
+    /** Uptime when work became pending while disconnected */
+    int64_t connecting_since;
+
+    /** Moving average of the connection latency in milliseconds, or 0 if no connection has been observed */
+    uint32_t average_connection_latency_ms;
+
+    /** Decay timer */
+    struct k_timer decay_timer;
+
+    /** Event raised when the decay timer expires */
+    struct blecon_event_t* decay_event;
+};
+
+/**
+ * @brief Initialize an adaptive advertising policy and set the idle mode
+ *
+ * @param adaptive_advertising the instance to initialize
+ * @param event_loop the event loop to use
+ * @param blecon the Blecon instance
+ * @param steps the decay curve, which must remain valid for the lifetime of the instance
+ * @param steps_count the number of steps in the decay curve
+ * @param idle_mode the mode to use once the decay curve has completed
+ */
+void blecon_zephyr_adaptive_advertising_init(struct blecon_zephyr_adaptive_advertising_t* adaptive_advertising, struct blecon_event_loop_t* event_loop,
+    struct blecon_t* blecon, const struct blecon_zephyr_adaptive_advertising_step_t* steps, size_t steps_count, enum blecon_advertising_mode_t idle_mode);
+
+/**
+ * @brief Notify that work is pending, for instance when requests are queued or blecon_connection_initiate() is called
+ *
+ * Calls are counted so that several sources of work can share the policy: each call must be balanced by a call to
+ * blecon_zephyr_adaptive_advertising_work_done().
+ *
+ * @param adaptive_advertising the instance
+ */
+void blecon_zephyr_adaptive_advertising_work_pending(struct blecon_zephyr_adaptive_advertising_t* adaptive_advertising);
+
+/**
+ * @brief Notify that work is done; the decay curve starts once all pending work is done
+ *
+ * @param adaptive_advertising the instance
+ */
+void blecon_zephyr_adaptive_advertising_work_done(struct blecon_zephyr_adaptive_advertising_t* adaptive_advertising);
+
+/**
+ * @brief Notify that a connection has been established, to be called from the on_connection() Blecon callback
+ *
+ * @param adaptive_advertising the instance
+ */
+void blecon_zephyr_adaptive_advertising_on_connection(struct blecon_zephyr_adaptive_advertising_t* adaptive_advertising);
+
+/**
+ * @brief Notify that the connection has been closed, to be called from the on_disconnection() Blecon callback
+ *
+ * @param adaptive_advertising the instance
+ */
+void blecon_zephyr_adaptive_advertising_on_disconnection(struct blecon_zephyr_adaptive_advertising_t* adaptive_advertising);
+
+/**
+ * @brief Get the moving average of the connection latency
+ *
+ * @param adaptive_advertising the instance
+ * @return the average time between work becoming pending and a connection being established, in milliseconds, or 0 if unknown
+ */
+uint32_t blecon_zephyr_adaptive_advertising_get_average_connection_latency(struct blecon_zephyr_adaptive_advertising_t* adaptive_advertising);
+
+#ifdef __cplusplus
+}
+#endif
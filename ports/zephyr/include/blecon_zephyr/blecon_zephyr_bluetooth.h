@@ -13,11 +13,105 @@ extern "C" {
 #include "stdint.h"
 #include "stddef.h"
 #include "blecon/port/blecon_bluetooth.h"
+#include "blecon_zephyr_scan_filter.h"
 
 struct blecon_event_loop_t;
 
+/**
+ * @brief Scan parameters
+ *
+ * Intervals and windows are in units of 0.625 ms. The controller scans for window out of every interval; if a duty
+ * cycle is set, scanning is also paused for duty_cycle_off_ms after every duty_cycle_on_ms of scanning.
+ */
+struct blecon_zephyr_bluetooth_scan_params_t {
+    /** Scan interval on the 1M PHY */
+    uint16_t interval;
+
+    /** Scan window on the 1M PHY */
+    uint16_t window;
+
+    /** Scan interval on the coded PHY, or 0 to use the 1M PHY interval */
+    uint16_t interval_coded;
+
+    /** Scan window on the coded PHY, or 0 to use the 1M PHY window */
+    uint16_t window_coded;
+
+    /** Duration of each scanning period in milliseconds, or 0 to scan continuously */
+    uint32_t duty_cycle_on_ms;
+
+    /** Duration of each pause in milliseconds, or 0 to scan continuously */
+    uint32_t duty_cycle_off_ms;
+};
+
+/**
+ * @brief Radio time used by each activity since the port was initialised or the statistics were reset
+ *
+ * Airtime and event counts are estimated from the parameters in use rather than measured by the controller.
+ */
+struct blecon_zephyr_bluetooth_radio_stats_t {
+    /** Time spent scanning, in milliseconds */
+    uint32_t scan_ms;
+
+    /** Estimated time the receiver was on for scanning (scan time scaled by the window to interval ratio), in milliseconds */
+    uint32_t scan_airtime_ms;
+
+    /** Time spent advertising, summed over advertising sets, in milliseconds */
+    uint32_t advertising_ms;
+
+    /** Estimated number of advertising events, summed over advertising sets */
+    uint32_t advertising_events;
+
+    /** Time spent connected, in milliseconds */
+    uint32_t connected_ms;
+};
+
 struct blecon_bluetooth_t* blecon_zephyr_bluetooth_init(struct blecon_event_loop_t* event_loop);
 
+/**
+ * @brief Set the filter applied to advertising reports before they are passed to the modem
+ *
+ * This should be called while no scan is in progress; the filter must remain valid until it is replaced.
+ *
+ * @param filter the filter to use, or NULL to keep all reports
+ */
+void blecon_zephyr_bluetooth_set_scan_filter(const struct blecon_zephyr_scan_filter_t* filter);
+
+/**
+ * @brief Set the scan parameters, replacing the defaults set in Kconfig
+ *
+ * The parameters are copied and take effect from the next scan.
+ *
+ * @param params the scan parameters
+ */
+void blecon_zephyr_bluetooth_set_scan_params(const struct blecon_zephyr_bluetooth_scan_params_t* params);
+
+/**
+ * @brief Pause scanning, for instance during a bulk transfer
+ *
+ * Calls can be nested; scanning resumes once each call has been matched by blecon_zephyr_bluetooth_scan_resume().
+ * This must be called from the event loop's context.
+ */
+void blecon_zephyr_bluetooth_scan_suspend(void);
+
+/**
+ * @brief Resume scanning paused with blecon_zephyr_bluetooth_scan_suspend()
+ *
+ * This must be called from the event loop's context.
+ */
+void blecon_zephyr_bluetooth_scan_resume(void);
+
+/**
+ * @brief Get the radio time used by each activity
+ *
+ * @param stats populated with the statistics, including activities in progress
+ */
+void blecon_zephyr_bluetooth_get_radio_stats(struct blecon_zephyr_bluetooth_radio_stats_t* stats);
+
+/**
+ * @brief Reset the radio time statistics
+ */
+void blecon_zephyr_bluetooth_reset_radio_stats(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,187 @@
+/*
+ * Copyright (c) Blecon Ltd
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <zephyr/kernel.h>
+
+#include "blecon/blecon.h"
+#include "blecon/blecon_request.h"
+#include "blecon/port/blecon_event_loop.h"
+
+#if defined(CONFIG_BLECON_ADAPTIVE_ADVERTISING)
+#include "blecon_zephyr_adaptive_advertising.h"
+#endif
+
+struct blecon_zephyr_connection_linger_t;
+
+/**
+ * @brief Callbacks structure for connection linger policies
+ */
+struct blecon_zephyr_connection_linger_callbacks_t {
+    /**
+     * @brief Called for each request held while disconnected when the connection could not be established in time, or NULL
+     *
+     * The request has not been submitted, so its on_closed() callback is not called.
+     *
+     * @param linger the instance
+     * @param request the request
+     */
+    void (*on_request_failed)(struct blecon_zephyr_connection_linger_t* linger, struct blecon_request_t* request);
+};
+
+/**
+ * @brief Structure representing a connection linger policy
+ *
+ * Keeps the connection open for an idle period after the last request has closed so that it can be reused
+ * by new requests, and terminates it once idle. Requests submitted while disconnected are held until connected,
+ * or until CONFIG_BLECON_CONNECTION_LINGER_CONNECT_TIMEOUT_MS has elapsed without a connection.
+ */
+struct blecon_zephyr_connection_linger_t {
+    /** The Blecon instance */
+    struct blecon_t* blecon;
+
+    /** Callbacks for connection linger operations */
+    const struct blecon_zephyr_connection_linger_callbacks_t* callbacks;
+
+    /** User data to be passed to callbacks */
+    void* user_data;
+
+    /** How long to keep the connection open once idle */
+    uint32_t idle_timeout_ms;
+
+    /** Number of requests submitted and not yet closed */
+    size_t active_requests_count;
+
+    /** Requests waiting for a connection */
+    struct blecon_request_t* pending_requests[CONFIG_BLECON_CONNECTION_LINGER_MAX_PENDING_REQUESTS];
+
+    /** Number of requests waiting for a connection */
+    size_t pending_requests_count;
+
+    /** Flag indicating if a connection has been initiated */
+    bool connecting;
+
+    /** Uptime when the connection was initiated */
+    int64_t connection_initiated_at;
+
+    /** Time it took to establish the last connection */
+    uint32_t last_connection_setup_time_ms;
+
+    /** Idle timer */
+    struct k_timer idle_timer;
+
+    /** Event raised when the idle timer expires */
+    struct blecon_event_t* idle_event;
+
+    /** Connection timer */
+    struct k_timer connect_timer;
+
+    /** Event raised when the connection timer expires */
+    struct blecon_event_t* connect_timeout_event;
+
+#if defined(CONFIG_BLECON_ADAPTIVE_ADVERTISING)
+    /** The adaptive advertising policy to notify, or NULL */
+    struct blecon_zephyr_adaptive_advertising_t* adaptive_advertising;
+
+    /** Flag indicating if work_pending() has been notified and not yet balanced */
+    bool work_pending;
+#endif
+};
+
+/**
+ * @brief Initialize a connection linger policy
+ *
+ * @param linger the instance to initialize
+ * @param event_loop the event loop to use
+ * @param blecon the Blecon instance
+ * @param idle_timeout_ms how long to keep the connection open after the last request has closed
+ * @param callbacks a pointer to the callback functions for connection linger operations
+ * @param user_data user data to pass to the callbacks
+ */
+void blecon_zephyr_connection_linger_init(struct blecon_zephyr_connection_linger_t* linger, struct blecon_event_loop_t* event_loop, struct blecon_t* blecon, uint32_t idle_timeout_ms,
+    const struct blecon_zephyr_connection_linger_callbacks_t* callbacks, void* user_data);
+
+/**
+ * @brief Submit a request, initiating a connection first if needed
+ *
+ * blecon_zephyr_connection_linger_request_closed() must be called from the request's on_closed() callback.
+ *
+ * @param linger the instance
+ * @param request the request to submit
+ * @return true on success, or false if too many requests are waiting for a connection or the connection could not be initiated
+ */
+bool blecon_zephyr_connection_linger_submit(struct blecon_zephyr_connection_linger_t* linger, struct blecon_request_t* request);
+
+/**
+ * @brief Notify that a request submitted with blecon_zephyr_connection_linger_submit() has closed
+ *
+ * This must be called once for each submitted request, including requests closed because the connection was lost.
+ *
+ * @param linger the instance
+ */
+void blecon_zephyr_connection_linger_request_closed(struct blecon_zephyr_connection_linger_t* linger);
+
+/**
+ * @brief Notify that a connection has been established, to be called from the on_connection() Blecon callback
+ *
+ * @param linger the instance
+ */
+void blecon_zephyr_connection_linger_on_connection(struct blecon_zephyr_connection_linger_t* linger);
+
+/**
+ * @brief Notify that the connection has been closed, to be called from the on_disconnection() Blecon callback
+ *
+ * @param linger the instance
+ */
+void blecon_zephyr_connection_linger_on_disconnection(struct blecon_zephyr_connection_linger_t* linger);
+
+/**
+ * @brief Set how long to keep the connection open once idle
+ *
+ * @param linger the instance
+ * @param idle_timeout_ms the idle timeout
+ */
+void blecon_zephyr_connection_linger_set_idle_timeout(struct blecon_zephyr_connection_linger_t* linger, uint32_t idle_timeout_ms);
+
+#if defined(CONFIG_BLECON_ADAPTIVE_ADVERTISING)
+/**
+ * @brief Notify an adaptive advertising policy while requests are held or in flight
+ *
+ * This must be called after initialization, before any request is submitted.
+ *
+ * @param linger the instance
+ * @param adaptive_advertising the adaptive advertising policy, or NULL
+ */
+void blecon_zephyr_connection_linger_set_adaptive_advertising(struct blecon_zephyr_connection_linger_t* linger,
+    struct blecon_zephyr_adaptive_advertising_t* adaptive_advertising);
+#endif
+
+/**
+ * @brief Get the time it took to establish the last connection
+ *
+ * @param linger the instance
+ * @return the time between the connection being initiated and established, in milliseconds
+ */
+uint32_t blecon_zephyr_connection_linger_get_last_connection_setup_time(struct blecon_zephyr_connection_linger_t* linger);
+
+/**
+ * @brief Get the user data associated with the instance
+ *
+ * @param linger the instance
+ * @return a pointer to the user data
+ */
+void* blecon_zephyr_connection_linger_get_user_data(struct blecon_zephyr_connection_linger_t* linger);
+
+#ifdef __cplusplus
+}
+#endif
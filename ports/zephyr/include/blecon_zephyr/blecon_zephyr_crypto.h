@@ -13,8 +13,9 @@ extern "C" {
 #include "stdint.h"
 #include "stddef.h"
 #include "blecon/port/blecon_crypto.h"
+#include "blecon/port/blecon_event_loop.h"
 
-struct blecon_crypto_t* blecon_zephyr_crypto_init(void);
+struct blecon_crypto_t* blecon_zephyr_crypto_init(struct blecon_event_loop_t* event_loop);
 
 #ifdef __cplusplus
 }
@@ -14,8 +14,39 @@ extern "C" {
 #include "stddef.h"
 #include "blecon/port/blecon_nfc.h"
 
+/**
+ * @brief Callback invoked when an NFC reader's field is detected
+ * @param nfc the NFC port instance
+ * @param user_data the user data passed to blecon_zephyr_nfc_set_field_on_callback()
+ */
+typedef void (*blecon_zephyr_nfc_field_on_callback_t)(struct blecon_nfc_t* nfc, void* user_data);
+
 struct blecon_nfc_t* blecon_zephyr_nfc_init(void);
 
+/**
+ * @brief Set a callback invoked as soon as an NFC reader's field is detected
+ *
+ * This can be used to switch to high performance advertising when the device is tapped, so that the connection
+ * is established with minimal latency. The callback is invoked from interrupt context, so it should only signal
+ * an event (see blecon_event_signal()). This should be called before NFC is started.
+ *
+ * @param nfc the NFC port instance
+ * @param callback the callback, or NULL
+ * @param user_data user data to pass to the callback
+ */
+void blecon_zephyr_nfc_set_field_on_callback(struct blecon_nfc_t* nfc, blecon_zephyr_nfc_field_on_callback_t callback, void* user_data);
+
+/**
+ * @brief Get the encoded NDEF message currently emulated
+ *
+ * The message is only encoded when the URI changes.
+ *
+ * @param nfc the NFC port instance
+ * @param sz populated with the size of the message
+ * @return a pointer to the message, or NULL if no message has been set
+ */
+const uint8_t* blecon_zephyr_nfc_get_ndef_message(struct blecon_nfc_t* nfc, size_t* sz);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,219 @@
+/*
+ * Copyright (c) Blecon Ltd
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <zephyr/fs/fcb.h>
+#include <zephyr/storage/flash_map.h>
+
+#include "blecon/blecon.h"
+#include "blecon/port/blecon_event_loop.h"
+
+#include "blecon_zephyr_request_batcher.h"
+
+struct blecon_zephyr_outbox_t;
+
+/**
+ * @brief Callbacks structure for outboxes
+ */
+struct blecon_zephyr_outbox_callbacks_t {
+    /**
+     * @brief Called when records are waiting to be sent but Blecon is not connected, or NULL
+     *
+     * The application can initiate a connection and call blecon_zephyr_outbox_drain() once connected.
+     *
+     * @param outbox the outbox instance
+     */
+    void (*on_connection_required)(struct blecon_zephyr_outbox_t* outbox);
+
+    /**
+     * @brief Called when draining stops, or NULL
+     *
+     * On failure, the records which were not sent are kept and blecon_zephyr_outbox_drain() can be called again.
+     *
+     * @param outbox the outbox instance
+     * @param success true if all the records have been sent, or false if a batch failed
+     */
+    void (*on_drained)(struct blecon_zephyr_outbox_t* outbox, bool success);
+};
+
+/**
+ * @brief A record being sent by an outbox
+ */
+struct blecon_zephyr_outbox_message_t {
+    /** The batcher message */
+    struct blecon_zephyr_request_batcher_message_t message;
+
+    /** The location of the record in flash */
+    struct fcb_entry loc;
+
+    /** Flag indicating if the batch containing the record has completed */
+    bool complete;
+
+    /** Flag indicating if the record has been sent */
+    bool sent;
+};
+
+/**
+ * @brief Structure representing an outbox
+ *
+ * An outbox stores one-way messages in a flash circular buffer until they have been sent, so that they survive
+ * disconnections and resets. Records are sent in order through a batcher, and flash sectors are erased once all their
+ * records have been sent. Delivery is at-least-once: the position of the last record sent is only kept in RAM, so after
+ * a reset all the records in the oldest sector which has not been erased yet are sent again.
+ *
+ * If batches keep failing while connected, for instance because the network's handler rejects a record, records are
+ * sent one at a time after CONFIG_BLECON_OUTBOX_MAX_RETRIES failed attempts, and the first record which fails on its
+ * own is skipped; draining then carries on with the following records.
+ *
+ * Records are stored in a blecon_outbox partition, which must be defined in the application's Partition Manager
+ * configuration (pm_static.yml), for instance:
+ *
+ *     blecon_outbox:
+ *       address: 0x174000
+ *       end_address: 0x17c000
+ *       region: flash_primary
+ *       size: 0x8000
+ */
+struct blecon_zephyr_outbox_t {
+    /** Callbacks for outbox operations */
+    const struct blecon_zephyr_outbox_callbacks_t* callbacks;
+
+    /** User data to be passed to callbacks */
+    void* user_data;
+
+    /** The batcher used to send records */
+    struct blecon_zephyr_request_batcher_t batcher;
+
+    /** The flash circular buffer */
+    struct fcb fcb;
+
+    /** The flash sectors used by the flash circular buffer */
+    struct flash_sector sectors[CONFIG_BLECON_OUTBOX_MAX_SECTORS];
+
+    /** The last record passed to the batcher */
+    struct fcb_entry send_loc;
+
+    /** The last record sent, with all records before it */
+    struct fcb_entry sent_loc;
+
+    /** Flag indicating if records are being sent */
+    bool draining;
+
+    /** Flag indicating if a batch failed, in which case records are sent again from sent_loc */
+    bool failed;
+
+    /** Number of consecutive failed attempts while connected */
+    uint32_t retries;
+
+    /** Flag indicating if records are sent one at a time to find a failing record */
+    bool isolating;
+
+    /** Number of records skipped because they kept failing */
+    uint32_t skipped_count;
+
+    /** Flag indicating if draining resumes once the current failure has completed, because the failing record was skipped */
+    bool resume;
+
+    /** Index of the oldest message in flight */
+    size_t messages_first;
+
+    /** Number of messages in flight */
+    size_t messages_count;
+
+    /** Messages in flight */
+    struct blecon_zephyr_outbox_message_t messages[CONFIG_BLECON_OUTBOX_MAX_MESSAGES_IN_FLIGHT];
+
+    /** Buffer used to read records from flash */
+    uint8_t record_buffer[CONFIG_BLECON_OUTBOX_MAX_RECORD_SZ];
+};
+
+/**
+ * @brief Initialize an outbox, using the blecon_outbox flash partition
+ *
+ * @param outbox the outbox instance to initialize
+ * @param event_loop the event loop to use
+ * @param blecon the Blecon instance to use to submit requests
+ * @param request_namespace the namespace of batch requests
+ * @param request_method the method of batch requests
+ * @param request_content_type the content type of batch requests, or NULL
+ * @param batch_buffer the buffer used by the batcher
+ * @param batch_buffer_sz the size of the buffer used by the batcher
+ * @param callbacks a pointer to the callback functions for outbox operations
+ * @param user_data user data to pass to the callbacks
+ */
+void blecon_zephyr_outbox_init(struct blecon_zephyr_outbox_t* outbox, struct blecon_event_loop_t* event_loop, struct blecon_t* blecon,
+    const char* request_namespace, const char* request_method, const char* request_content_type,
+    uint8_t* batch_buffer, size_t batch_buffer_sz,
+    const struct blecon_zephyr_outbox_callbacks_t* callbacks, void* user_data);
+
+/**
+ * @brief Store a message in the outbox
+ *
+ * This can be called at any time; the message is sent when blecon_zephyr_outbox_drain() is next called while connected.
+ *
+ * @param outbox the outbox instance
+ * @param data the message's data
+ * @param sz the size of the message's data (maximum CONFIG_BLECON_OUTBOX_MAX_RECORD_SZ)
+ * @return true on success, or false if the outbox is full
+ */
+bool blecon_zephyr_outbox_push(struct blecon_zephyr_outbox_t* outbox, const uint8_t* data, size_t sz);
+
+/**
+ * @brief Send the records stored in the outbox
+ *
+ * This should be called when a connection is established.
+ *
+ * @param outbox the outbox instance
+ */
+void blecon_zephyr_outbox_drain(struct blecon_zephyr_outbox_t* outbox);
+
+/**
+ * @brief Check whether all the records in the outbox have been sent
+ *
+ * @param outbox the outbox instance
+ * @return true if there is nothing left to send
+ */
+bool blecon_zephyr_outbox_is_empty(struct blecon_zephyr_outbox_t* outbox);
+
+/**
+ * @brief Get the number of records which were skipped because they kept failing
+ *
+ * @param outbox the outbox instance
+ * @return the number of records skipped
+ */
+uint32_t blecon_zephyr_outbox_get_skipped_count(struct blecon_zephyr_outbox_t* outbox);
+
+#if defined(CONFIG_BLECON_ADAPTIVE_ADVERTISING)
+/**
+ * @brief Notify an adaptive advertising policy while records are being sent
+ *
+ * This must be called after initialization, before the outbox is drained.
+ *
+ * @param outbox the outbox instance
+ * @param adaptive_advertising the adaptive advertising policy, or NULL
+ */
+void blecon_zephyr_outbox_set_adaptive_advertising(struct blecon_zephyr_outbox_t* outbox,
+    struct blecon_zephyr_adaptive_advertising_t* adaptive_advertising);
+#endif
+
+/**
+ * @brief Get the user data associated with the outbox
+ *
+ * @param outbox the outbox instance
+ * @return a pointer to the user data
+ */
+void* blecon_zephyr_outbox_get_user_data(struct blecon_zephyr_outbox_t* outbox);
+
+#ifdef __cplusplus
+}
+#endif
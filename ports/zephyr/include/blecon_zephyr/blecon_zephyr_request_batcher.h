@@ -0,0 +1,214 @@
+/*
+ * Copyright (c) Blecon Ltd
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <zephyr/kernel.h>
+
+#include "blecon/blecon.h"
+#include "blecon/blecon_list.h"
+#include "blecon/blecon_request.h"
+#include "blecon/port/blecon_event_loop.h"
+
+#if defined(CONFIG_BLECON_ADAPTIVE_ADVERTISING)
+#include "blecon_zephyr_adaptive_advertising.h"
+#endif
+
+struct blecon_zephyr_request_batcher_t;
+
+/**
+ * @brief A message queued in a batcher
+ */
+struct blecon_zephyr_request_batcher_message_t {
+    /** User data associated with the message */
+    void* user_data;
+
+    /** Node in the batch's list of messages */
+    struct blecon_list_node_t node;
+};
+
+/**
+ * @brief Callbacks structure for batchers
+ */
+struct blecon_zephyr_request_batcher_callbacks_t {
+    /**
+     * @brief Called when the batch containing a message has been sent, or has failed
+     * @param batcher the batcher instance
+     * @param message the message
+     * @param sent true if the message was sent
+     */
+    void (*on_message_sent)(struct blecon_zephyr_request_batcher_t* batcher, struct blecon_zephyr_request_batcher_message_t* message, bool sent);
+
+    /**
+     * @brief Called when a batch is ready to be sent but Blecon is not connected, or NULL
+     *
+     * The application can initiate a connection and call blecon_zephyr_request_batcher_flush() once connected.
+     *
+     * @param batcher the batcher instance
+     */
+    void (*on_connection_required)(struct blecon_zephyr_request_batcher_t* batcher);
+};
+
+/**
+ * @brief A batch of messages, sent as a single one-way request
+ */
+struct blecon_zephyr_request_batcher_batch_t {
+    /** The batcher this batch belongs to */
+    struct blecon_zephyr_request_batcher_t* batcher;
+
+    /** The request used to send this batch */
+    struct blecon_request_t request;
+
+    /** The send data operation used to send this batch */
+    struct blecon_request_send_data_op_t send_op;
+
+    /** The batch's records */
+    uint8_t* buffer;
+
+    /** The number of bytes used in the buffer */
+    size_t sz;
+
+    /** The messages in this batch */
+    struct blecon_list_t messages;
+
+    /** Flag indicating if this batch is being sent */
+    bool in_flight;
+};
+
+/**
+ * @brief Structure representing a batcher
+ *
+ * A batcher aggregates small one-way messages sharing the same request parameters into batches of length-delimited records
+ * (each record is prefixed with its length encoded as an unsigned LEB128 varint), which are sent as a single request.
+ * One batch is filled while the other is being sent.
+ */
+struct blecon_zephyr_request_batcher_t {
+    /** The Blecon instance used to submit requests */
+    struct blecon_t* blecon;
+
+    /** The parameters used for batch requests */
+    struct blecon_request_parameters_t request_parameters;
+
+    /** Callbacks for batcher operations */
+    const struct blecon_zephyr_request_batcher_callbacks_t* callbacks;
+
+    /** User data to be passed to callbacks */
+    void* user_data;
+
+    /** The size of each batch's buffer */
+    size_t batch_buffer_sz;
+
+    /** The size from which a batch is sent immediately */
+    size_t flush_sz;
+
+    /** The maximum time a message waits in a batch before it is sent */
+    uint32_t max_age_ms;
+
+    /** The batches */
+    struct blecon_zephyr_request_batcher_batch_t batches[2];
+
+    /** Index of the batch being filled */
+    size_t current_batch;
+
+    /** Timer started when the first message is added to a batch */
+    struct k_timer age_timer;
+
+    /** Event raised when the age timer expires */
+    struct blecon_event_t* flush_event;
+
+#if defined(CONFIG_BLECON_ADAPTIVE_ADVERTISING)
+    /** The adaptive advertising policy to notify, or NULL */
+    struct blecon_zephyr_adaptive_advertising_t* adaptive_advertising;
+
+    /** Flag indicating if work_pending() has been notified and not yet balanced */
+    bool work_pending;
+#endif
+};
+
+/**
+ * @brief Initialize a batcher
+ *
+ * @param batcher the batcher instance to initialize
+ * @param event_loop the event loop to use
+ * @param blecon the Blecon instance to use to submit requests
+ * @param request_namespace the namespace of batch requests
+ * @param request_method the method of batch requests
+ * @param request_content_type the content type of batch requests, or NULL
+ * @param buffer the buffer to use, split between the two batches (each half is at most BLECON_MTU)
+ * @param buffer_sz the size of the buffer
+ * @param flush_sz the size from which a batch is sent immediately
+ * @param max_age_ms the maximum time a message waits in a batch before it is sent
+ * @param callbacks a pointer to the callback functions for batcher operations
+ * @param user_data user data to pass to the callbacks
+ */
+void blecon_zephyr_request_batcher_init(struct blecon_zephyr_request_batcher_t* batcher, struct blecon_event_loop_t* event_loop, struct blecon_t* blecon,
+    const char* request_namespace, const char* request_method, const char* request_content_type,
+    uint8_t* buffer, size_t buffer_sz, size_t flush_sz, uint32_t max_age_ms,
+    const struct blecon_zephyr_request_batcher_callbacks_t* callbacks, void* user_data);
+
+/**
+ * @brief Add a message to the current batch
+ *
+ * The message's data is copied, so it can be released as soon as this function returns.
+ *
+ * @param batcher the batcher instance
+ * @param message the message instance, which must remain valid until on_message_sent() is called
+ * @param data the message's data
+ * @param sz the size of the message's data
+ * @param user_data user data to associate with the message
+ * @return true if the message was queued, or false if it does not fit in a batch or both batches are busy
+ */
+bool blecon_zephyr_request_batcher_send(struct blecon_zephyr_request_batcher_t* batcher, struct blecon_zephyr_request_batcher_message_t* message,
+    const uint8_t* data, size_t sz, void* user_data);
+
+/**
+ * @brief Send the current batch now
+ *
+ * This should be called once connected if on_connection_required() was called, and before terminating a connection.
+ *
+ * @param batcher the batcher instance
+ */
+void blecon_zephyr_request_batcher_flush(struct blecon_zephyr_request_batcher_t* batcher);
+
+/**
+ * @brief Drop the current batch if it has not been sent yet
+ *
+ * on_message_sent() is called with sent set to false for each of the batch's messages.
+ *
+ * @param batcher the batcher instance
+ */
+void blecon_zephyr_request_batcher_discard(struct blecon_zephyr_request_batcher_t* batcher);
+
+#if defined(CONFIG_BLECON_ADAPTIVE_ADVERTISING)
+/**
+ * @brief Notify an adaptive advertising policy while messages are queued or being sent
+ *
+ * This must be called after initialization, before any message is added.
+ *
+ * @param batcher the batcher instance
+ * @param adaptive_advertising the adaptive advertising policy, or NULL
+ */
+void blecon_zephyr_request_batcher_set_adaptive_advertising(struct blecon_zephyr_request_batcher_t* batcher,
+    struct blecon_zephyr_adaptive_advertising_t* adaptive_advertising);
+#endif
+
+/**
+ * @brief Get the user data associated with the batcher
+ *
+ * @param batcher the batcher instance
+ * @return a pointer to the user data
+ */
+void* blecon_zephyr_request_batcher_get_user_data(struct blecon_zephyr_request_batcher_t* batcher);
+
+#ifdef __cplusplus
+}
+#endif
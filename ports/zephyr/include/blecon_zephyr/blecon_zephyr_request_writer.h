@@ -0,0 +1,265 @@
+/*
+ * Copyright (c) Blecon Ltd
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "blecon/blecon_list.h"
+#include "blecon/blecon_request.h"
+#include "blecon/port/blecon_event_loop.h"
+
+struct blecon_zephyr_request_writer_t;
+
+enum blecon_zephyr_request_writer_priority_t {
+    blecon_zephyr_request_writer_priority_normal,   /**< Always use all the operations in flight available */
+    blecon_zephyr_request_writer_priority_bulk,     /**< Yield to urgent requests by reducing the number of operations in flight */
+};
+
+/**
+ * @brief Callbacks structure for request writers
+ */
+struct blecon_zephyr_request_writer_callbacks_t {
+    /**
+     * @brief Called to pull more data from the application (pull model), or NULL if data is pushed with blecon_zephyr_request_writer_write()
+     * @param writer the writer instance
+     * @param data the buffer to fill
+     * @param max_sz the maximum number of bytes to write to the buffer
+     * @param finished set to true by the application if this is the end of the data
+     * @return the number of bytes written to the buffer
+     */
+    size_t (*on_read)(struct blecon_zephyr_request_writer_t* writer, uint8_t* data, size_t max_sz, bool* finished);
+
+    /**
+     * @brief Called when all the data has been sent, or when sending failed
+     * @param writer the writer instance
+     * @param success true if all the data was sent
+     */
+    void (*on_done)(struct blecon_zephyr_request_writer_t* writer, bool success);
+};
+
+/**
+ * @brief A send data operation owned by a request writer
+ */
+struct blecon_zephyr_request_writer_op_t {
+    /** The underlying send data operation */
+    struct blecon_request_send_data_op_t op;
+
+    /** The writer this operation belongs to */
+    struct blecon_zephyr_request_writer_t* writer;
+
+    /** The number of bytes sent by this operation */
+    size_t sz;
+
+    /** Flag indicating if the operation has completed */
+    bool complete;
+};
+
+/**
+ * @brief Structure representing a request writer
+ *
+ * A request writer streams data for a request from a ring buffer, splitting it into chunks
+ * and keeping a bounded number of send data operations in flight
+ */
+struct blecon_zephyr_request_writer_t {
+    /** The request written to */
+    struct blecon_request_t* request;
+
+    /** A copy of the request's parameters, with the writer's own callbacks */
+    struct blecon_request_parameters_t request_parameters;
+
+    /** The request callbacks, with on_data_sent handled by the writer */
+    struct blecon_request_callbacks_t request_callbacks;
+
+    /** Callbacks for writer operations */
+    const struct blecon_zephyr_request_writer_callbacks_t* callbacks;
+
+    /** User data to be passed to callbacks */
+    void* user_data;
+
+    /** The ring buffer holding data until it has been sent */
+    uint8_t* buffer;
+
+    /** The size of the ring buffer */
+    size_t buffer_sz;
+
+    /** The maximum size of a single send data operation */
+    size_t chunk_sz;
+
+    /** The maximum number of send data operations in flight */
+    size_t max_ops_in_flight;
+
+    /** The writer's priority */
+    enum blecon_zephyr_request_writer_priority_t priority;
+
+    /** Node in the list of bulk writers */
+    struct blecon_list_node_t bulk_writers_list_node;
+
+    /** Flag indicating if a throttled bulk writer may queue one more chunk */
+    bool quantum_available;
+
+    /** Total number of bytes written to the ring buffer */
+    size_t head;
+
+    /** Total number of bytes queued for sending */
+    size_t send_pos;
+
+    /** Total number of bytes sent */
+    size_t tail;
+
+    /** Flag indicating if the end of the data has been written */
+    bool closed;
+
+    /** Flag indicating if the last send data operation has been queued */
+    bool finished_queued;
+
+    /** Flag indicating if on_done() has been called */
+    bool done;
+
+    /** Index of the oldest operation in flight */
+    size_t ops_first;
+
+    /** Number of operations in flight */
+    size_t ops_count;
+
+    /** Send data operations */
+    struct blecon_zephyr_request_writer_op_t ops[CONFIG_BLECON_REQUEST_WRITER_MAX_OPS_IN_FLIGHT];
+};
+
+/**
+ * @brief Initialize a request writer and the request it writes to
+ *
+ * The request is initialised with a copy of the parameters; the on_data_sent() request callback is handled by the writer
+ * and all other request callbacks are passed through.
+ *
+ * The writer instance must be zero-initialised or previously initialised; a writer re-initialised at the bulk priority
+ * is removed from the list of bulk writers.
+ *
+ * @param writer the writer instance to initialize
+ * @param request the request to initialize and write to
+ * @param parameters the request's parameters
+ * @param buffer the ring buffer to use
+ * @param buffer_sz the size of the ring buffer (should be at least chunk_sz * CONFIG_BLECON_REQUEST_WRITER_MAX_OPS_IN_FLIGHT for full throughput)
+ * @param chunk_sz the maximum size of a single send data operation (maximum BLECON_MTU)
+ * @param callbacks a pointer to the callback functions for writer operations
+ * @param user_data user data to pass to the callbacks
+ */
+void blecon_zephyr_request_writer_init(struct blecon_zephyr_request_writer_t* writer, struct blecon_request_t* request,
+    const struct blecon_request_parameters_t* parameters, uint8_t* buffer, size_t buffer_sz, size_t chunk_sz,
+    const struct blecon_zephyr_request_writer_callbacks_t* callbacks, void* user_data);
+
+/**
+ * @brief Reset the writer and queue the first chunks of data
+ *
+ * This should be called after blecon_request_cleanup() and before the request is submitted.
+ *
+ * @param writer the writer instance
+ */
+void blecon_zephyr_request_writer_start(struct blecon_zephyr_request_writer_t* writer);
+
+/**
+ * @brief Push data to the writer (push model)
+ *
+ * @param writer the writer instance
+ * @param data the data to write
+ * @param sz the size of the data
+ * @return the number of bytes accepted, which is less than sz if the ring buffer is full
+ */
+size_t blecon_zephyr_request_writer_write(struct blecon_zephyr_request_writer_t* writer, const uint8_t* data, size_t sz);
+
+/**
+ * @brief Mark the end of the data (push model)
+ *
+ * @param writer the writer instance
+ */
+void blecon_zephyr_request_writer_close(struct blecon_zephyr_request_writer_t* writer);
+
+/**
+ * @brief Notify the writer that more data can be pulled (pull model)
+ *
+ * This should be called if on_read() previously returned 0 bytes without finishing.
+ *
+ * @param writer the writer instance
+ */
+void blecon_zephyr_request_writer_data_available(struct blecon_zephyr_request_writer_t* writer);
+
+/**
+ * @brief Set up urgent request tracking
+ *
+ * This must be called once before any writer is set to the bulk priority.
+ *
+ * @param event_loop the event loop to use
+ */
+void blecon_zephyr_request_writer_urgent_requests_init(struct blecon_event_loop_t* event_loop);
+
+/**
+ * @brief Set the priority of a writer
+ *
+ * Bulk writers keep at most CONFIG_BLECON_REQUEST_WRITER_BULK_MAX_OPS_IN_FLIGHT_WHILE_URGENT operations in flight
+ * (by default none, so they pause) while urgent requests are pending. So that they are not starved, each bulk writer
+ * may queue one more chunk every CONFIG_BLECON_REQUEST_WRITER_BULK_QUANTUM_MS milliseconds. Bulk writers resume
+ * as soon as the last urgent request ends.
+ *
+ * @param writer the writer instance
+ * @param priority the writer's priority
+ */
+void blecon_zephyr_request_writer_set_priority(struct blecon_zephyr_request_writer_t* writer, enum blecon_zephyr_request_writer_priority_t priority);
+
+/**
+ * @brief Mark a request as urgent
+ *
+ * This should be called once the request has been submitted. The request stops being urgent when
+ * blecon_zephyr_request_writer_end_urgent_request() is called, or at the latest when its status is no longer pending.
+ *
+ * @param request the urgent request
+ * @return true on success, or false if CONFIG_BLECON_REQUEST_WRITER_MAX_URGENT_REQUESTS requests are already urgent
+ */
+bool blecon_zephyr_request_writer_begin_urgent_request(struct blecon_request_t* request);
+
+/**
+ * @brief Mark the end of an urgent request, for instance from its on_closed() callback
+ *
+ * @param request the urgent request
+ */
+void blecon_zephyr_request_writer_end_urgent_request(struct blecon_request_t* request);
+
+/**
+ * @brief Forget all urgent requests, to be called from the on_disconnection() Blecon callback
+ */
+void blecon_zephyr_request_writer_clear_urgent_requests(void);
+
+/**
+ * @brief Get the number of bytes which have been sent so far
+ *
+ * @param writer the writer instance
+ * @return the number of bytes sent
+ */
+size_t blecon_zephyr_request_writer_get_bytes_sent(struct blecon_zephyr_request_writer_t* writer);
+
+/**
+ * @brief Get the number of bytes which can be pushed to the writer without blocking (push model)
+ *
+ * @param writer the writer instance
+ * @return the free space in the ring buffer
+ */
+size_t blecon_zephyr_request_writer_get_free_space(struct blecon_zephyr_request_writer_t* writer);
+
+/**
+ * @brief Get the user data associated with the writer
+ *
+ * @param writer the writer instance
+ * @return a pointer to the user data
+ */
+void* blecon_zephyr_request_writer_get_user_data(struct blecon_zephyr_request_writer_t* writer);
+
+#ifdef __cplusplus
+}
+#endif
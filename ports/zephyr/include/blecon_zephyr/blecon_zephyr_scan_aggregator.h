@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) Blecon Ltd
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "blecon/blecon_modem.h"
+#include "blecon/blecon_bluetooth_types.h"
+
+#define BLECON_ZEPHYR_SCAN_AGGREGATOR_INVALID_INDEX UINT16_MAX
+
+struct blecon_zephyr_scan_aggregator_t;
+
+/**
+ * @brief A device seen during a scan window
+ */
+struct blecon_zephyr_scan_aggregator_record_t {
+    /** The device's address */
+    struct blecon_bluetooth_addr_t bt_addr;
+
+    /** The advertising set ID */
+    uint8_t sid;
+
+    /** The advertised TX power from the latest report */
+    int8_t tx_power;
+
+    /** The lowest RSSI */
+    int8_t rssi_min;
+
+    /** The highest RSSI */
+    int8_t rssi_max;
+
+    /** The mean RSSI, set when the record is reported */
+    int8_t rssi_mean;
+
+    /** Sum of RSSI values, used to compute the mean */
+    int32_t rssi_sum;
+
+    /** The number of reports received */
+    uint32_t count;
+
+    /** Hash (FNV-1a) of the latest advertising data, excluding scan responses, or 0 if only scan responses were received */
+    uint32_t adv_data_hash;
+
+    /** Next record in the same hash bucket */
+    uint16_t bucket_next;
+
+    /** Previous (more recently seen) record in the LRU list */
+    uint16_t lru_prev;
+
+    /** Next (less recently seen) record in the LRU list */
+    uint16_t lru_next;
+};
+
+/**
+ * @brief Callbacks structure for scan aggregators
+ */
+struct blecon_zephyr_scan_aggregator_callbacks_t {
+    /**
+     * @brief Called for each record when the window is flushed, or when a record is evicted to make room
+     * @param aggregator the scan aggregator instance
+     * @param record the record, only valid for the duration of the call
+     */
+    void (*on_record)(struct blecon_zephyr_scan_aggregator_t* aggregator, const struct blecon_zephyr_scan_aggregator_record_t* record);
+};
+
+/**
+ * @brief Structure representing a scan aggregator
+ *
+ * A scan aggregator keeps one record per device (address and SID) per scan window, with the number of reports,
+ * RSSI statistics and a hash of the latest advertising data. Records are kept in a fixed-capacity hash table; when
+ * it is full, the least recently seen device is reported and evicted.
+ *
+ * Raw scan reports are buffered by Blecon without a reception time, so records carry no timestamps; the scan window
+ * itself bounds when the device was seen.
+ */
+struct blecon_zephyr_scan_aggregator_t {
+    /** Callbacks for scan aggregator operations */
+    const struct blecon_zephyr_scan_aggregator_callbacks_t* callbacks;
+
+    /** User data to be passed to callbacks */
+    void* user_data;
+
+    /** Records */
+    struct blecon_zephyr_scan_aggregator_record_t records[CONFIG_BLECON_SCAN_AGGREGATOR_MAX_DEVICES];
+
+    /** Number of records in use */
+    size_t records_count;
+
+    /** First record in each hash bucket */
+    uint16_t buckets[CONFIG_BLECON_SCAN_AGGREGATOR_MAX_DEVICES];
+
+    /** Most recently seen record */
+    uint16_t lru_head;
+
+    /** Least recently seen record */
+    uint16_t lru_tail;
+};
+
+/**
+ * @brief Initialize a scan aggregator
+ *
+ * @param aggregator the scan aggregator instance to initialize
+ * @param callbacks a pointer to the callback functions for scan aggregator operations
+ * @param user_data user data to pass to the callbacks
+ */
+void blecon_zephyr_scan_aggregator_init(struct blecon_zephyr_scan_aggregator_t* aggregator,
+    const struct blecon_zephyr_scan_aggregator_callbacks_t* callbacks, void* user_data);
+
+/**
+ * @brief Add a raw scan report to the current window
+ *
+ * This is typically called from the raw scan report iterator passed to blecon_scan_get_data().
+ *
+ * @param aggregator the scan aggregator instance
+ * @param report the raw scan report
+ */
+void blecon_zephyr_scan_aggregator_add(struct blecon_zephyr_scan_aggregator_t* aggregator, const struct blecon_modem_raw_scan_report_t* report);
+
+/**
+ * @brief Report all the records in the current window and start a new window
+ *
+ * @param aggregator the scan aggregator instance
+ */
+void blecon_zephyr_scan_aggregator_flush(struct blecon_zephyr_scan_aggregator_t* aggregator);
+
+/**
+ * @brief Get the number of devices in the current window
+ *
+ * @param aggregator the scan aggregator instance
+ * @return the number of records
+ */
+size_t blecon_zephyr_scan_aggregator_get_count(struct blecon_zephyr_scan_aggregator_t* aggregator);
+
+/**
+ * @brief Get the user data associated with the scan aggregator
+ *
+ * @param aggregator the scan aggregator instance
+ * @return a pointer to the user data
+ */
+void* blecon_zephyr_scan_aggregator_get_user_data(struct blecon_zephyr_scan_aggregator_t* aggregator);
+
+#ifdef __cplusplus
+}
+#endif
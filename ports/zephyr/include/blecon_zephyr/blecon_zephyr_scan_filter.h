@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) Blecon Ltd
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "blecon/blecon_bluetooth_types.h"
+
+/**
+ * @brief A manufacturer specific data prefix to match
+ */
+struct blecon_zephyr_scan_filter_manufacturer_data_t {
+    /** The prefix to match, starting with the company ID (little-endian) */
+    const uint8_t* prefix;
+
+    /** The size of the prefix */
+    size_t prefix_sz;
+};
+
+/**
+ * @brief Structure representing a scan filter
+ *
+ * Advertising reports are filtered in the Bluetooth port before they are passed to the modem, so that discarded reports
+ * are never copied to the scan buffer. A report is kept if it passes all of the following checks:
+ * - its RSSI is at least min_rssi
+ * - its address is in addrs (or, if addrs_deny is set, is not in addrs); skipped if addrs_count is 0
+ * - it contains one of ad_types, a 16-bit service UUID from service_uuids (in a UUID list or service data),
+ *   or manufacturer specific data starting with one of manufacturer_data; skipped if none of these are set
+ *
+ * Blecon advertising reports are always kept so that peer scanning is not affected, unless the controller's
+ * filter accept list is used.
+ */
+struct blecon_zephyr_scan_filter_t {
+    /** The minimum RSSI, or INT8_MIN to keep all reports */
+    int8_t min_rssi;
+
+    /** Addresses to allow (or deny) */
+    const struct blecon_bluetooth_addr_t* addrs;
+
+    /** Number of addresses */
+    size_t addrs_count;
+
+    /** Flag indicating if addrs is a deny list rather than an allow list */
+    bool addrs_deny;
+
+    /**
+     * Flag indicating if an allow list should be loaded in the controller's filter accept list
+     * (requires CONFIG_BT_FILTER_ACCEPT_LIST), in which case reports from other devices, including Blecon devices,
+     * are dropped by the controller; if the list does not fit in the controller, only the software filter is used
+     */
+    bool use_accept_list;
+
+    /** AD types to match */
+    const uint8_t* ad_types;
+
+    /** Number of AD types */
+    size_t ad_types_count;
+
+    /** 16-bit service UUIDs to match */
+    const uint16_t* service_uuids;
+
+    /** Number of 16-bit service UUIDs */
+    size_t service_uuids_count;
+
+    /** Manufacturer specific data prefixes to match */
+    const struct blecon_zephyr_scan_filter_manufacturer_data_t* manufacturer_data;
+
+    /** Number of manufacturer specific data prefixes */
+    size_t manufacturer_data_count;
+};
+
+/**
+ * @brief Check whether an advertising report passes a filter
+ *
+ * @param filter the filter
+ * @param bt_addr the advertiser's address
+ * @param rssi the report's RSSI
+ * @param data the advertising data
+ * @param data_sz the size of the advertising data
+ * @return true if the report should be kept
+ */
+bool blecon_zephyr_scan_filter_match(const struct blecon_zephyr_scan_filter_t* filter, const struct blecon_bluetooth_addr_t* bt_addr,
+    int8_t rssi, const uint8_t* data, size_t data_sz);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,212 @@
+/*
+ * Copyright (c) Blecon Ltd
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "blecon/blecon.h"
+#include "blecon/blecon_modem.h"
+#include "blecon/blecon_request.h"
+
+#include "blecon_zephyr_request_writer.h"
+#if defined(CONFIG_BLECON_SCAN_AGGREGATOR)
+#include "blecon_zephyr_scan_aggregator.h"
+#endif
+
+#define BLECON_ZEPHYR_SCAN_UPLOADER_FORMAT_VERSION  1
+#define BLECON_ZEPHYR_SCAN_UPLOADER_HEADER_SZ       (1 + 4)
+
+// Record types
+#define BLECON_ZEPHYR_SCAN_UPLOADER_RECORD_PEER         0x01
+#define BLECON_ZEPHYR_SCAN_UPLOADER_RECORD_RAW          0x02
+#define BLECON_ZEPHYR_SCAN_UPLOADER_RECORD_AGGREGATED   0x03
+
+// Maximum record size (raw record with 255 bytes of advertising data)
+#define BLECON_ZEPHYR_SCAN_UPLOADER_MAX_RECORD_SZ   (1 + BLECON_BLUETOOTH_ADDR_SZ + 1 + 1 + 1 + 1 + 1 + 255)
+
+struct blecon_zephyr_scan_uploader_t;
+
+/**
+ * @brief Callbacks structure for scan uploaders
+ */
+struct blecon_zephyr_scan_uploader_callbacks_t {
+    /**
+     * @brief Called when records are added but Blecon is not connected, or NULL
+     *
+     * This is called once per disconnected period: it is called again only after a batch has been started.
+     * @param uploader the scan uploader instance
+     */
+    void (*on_connection_required)(struct blecon_zephyr_scan_uploader_t* uploader);
+
+    /**
+     * @brief Called when a batch's request has closed, or NULL
+     * @param uploader the scan uploader instance
+     * @param success true if the batch was sent successfully
+     */
+    void (*on_batch_done)(struct blecon_zephyr_scan_uploader_t* uploader, bool success);
+};
+
+/**
+ * @brief A batch being uploaded
+ */
+struct blecon_zephyr_scan_uploader_batch_t {
+    /** The uploader this batch belongs to */
+    struct blecon_zephyr_scan_uploader_t* uploader;
+
+    /** The batch's request */
+    struct blecon_request_t request;
+
+    /** The writer streaming records to the request */
+    struct blecon_zephyr_request_writer_t writer;
+
+    /** Number of bytes written to the batch */
+    size_t sz;
+
+    /** Flag indicating if the batch's request has been submitted and has not closed yet */
+    bool in_progress;
+
+    /** Flag indicating if the batch has been closed for writing */
+    bool closed;
+};
+
+/**
+ * @brief Structure representing a scan uploader
+ *
+ * A scan uploader encodes scan reports into a compact binary format and streams them as one-way requests while the
+ * scan continues. A batch starts with a header: the format version (1 byte) and the uptime in milliseconds (4 bytes,
+ * little-endian). Each record then starts with its type (1 byte); multi-byte fields are little-endian:
+ * - peer (0x01): Blecon ID (16 bytes), flags (bit 0: announcing), TX power, RSSI
+ * - raw (0x02): address (6 bytes), address type, flags (bits 0-3: SID, bit 4: scan response, bit 5: advertising data
+ *   truncated to 255 bytes), TX power, RSSI, advertising data size (1 byte), advertising data
+ * - aggregated (0x03): address (6 bytes), address type, SID, TX power, minimum, maximum and mean RSSI, count (2 bytes),
+ *   advertising data hash (4 bytes)
+ *
+ * Two batches alternate, so that records can be written while the previous batch's request is closing. Buffer space is
+ * released once each chunk has been sent, which doesn't mean it has been acknowledged: delivery is only confirmed when
+ * the batch's request closes successfully. Records that don't fit are dropped and counted.
+ */
+struct blecon_zephyr_scan_uploader_t {
+    /** The Blecon instance used to submit requests */
+    struct blecon_t* blecon;
+
+    /** Callbacks for scan uploader operations */
+    const struct blecon_zephyr_scan_uploader_callbacks_t* callbacks;
+
+    /** User data to be passed to callbacks */
+    void* user_data;
+
+    /** The batches */
+    struct blecon_zephyr_scan_uploader_batch_t batches[2];
+
+    /** Index of the batch records are written to */
+    size_t current_batch;
+
+    /** The batch size after which a batch is closed */
+    size_t batch_sz;
+
+    /** Number of records dropped */
+    uint32_t dropped_count;
+
+    /** Flag indicating if on_connection_required() has been called since the last batch was started */
+    bool connection_required_notified;
+};
+
+/**
+ * @brief Initialize a scan uploader
+ *
+ * @param uploader the scan uploader instance to initialize
+ * @param blecon the Blecon instance to use to submit requests
+ * @param request_namespace the namespace of batch requests
+ * @param request_method the method of batch requests
+ * @param buffer the buffer used by the batches' writers, split between the two batches
+ * @param buffer_sz the size of the buffer
+ * @param chunk_sz the maximum size of a single send data operation (maximum BLECON_MTU)
+ * @param batch_sz the number of bytes after which a batch's request is closed and a new one started
+ * @param callbacks a pointer to the callback functions for scan uploader operations
+ * @param user_data user data to pass to the callbacks
+ */
+void blecon_zephyr_scan_uploader_init(struct blecon_zephyr_scan_uploader_t* uploader, struct blecon_t* blecon,
+    const char* request_namespace, const char* request_method,
+    uint8_t* buffer, size_t buffer_sz, size_t chunk_sz, size_t batch_sz,
+    const struct blecon_zephyr_scan_uploader_callbacks_t* callbacks, void* user_data);
+
+/**
+ * @brief Add a peer scan report
+ *
+ * @param uploader the scan uploader instance
+ * @param report the report
+ * @return true if the record was added, or false if it was dropped
+ */
+bool blecon_zephyr_scan_uploader_add_peer_report(struct blecon_zephyr_scan_uploader_t* uploader, const struct blecon_modem_peer_scan_report_t* report);
+
+/**
+ * @brief Add a raw scan report
+ *
+ * @param uploader the scan uploader instance
+ * @param report the report
+ * @return true if the record was added, or false if it was dropped
+ */
+bool blecon_zephyr_scan_uploader_add_raw_report(struct blecon_zephyr_scan_uploader_t* uploader, const struct blecon_modem_raw_scan_report_t* report);
+
+#if defined(CONFIG_BLECON_SCAN_AGGREGATOR)
+/**
+ * @brief Add a record produced by a scan aggregator
+ *
+ * @param uploader the scan uploader instance
+ * @param record the record
+ * @return true if the record was added, or false if it was dropped
+ */
+bool blecon_zephyr_scan_uploader_add_aggregated_record(struct blecon_zephyr_scan_uploader_t* uploader, const struct blecon_zephyr_scan_aggregator_record_t* record);
+#endif
+
+/**
+ * @brief Peer scan report iterator to pass to blecon_scan_get_data(), with the uploader as user data
+ *
+ * @param report the report
+ * @param user_data the scan uploader instance
+ */
+void blecon_zephyr_scan_uploader_peer_scan_report_iterator(const struct blecon_modem_peer_scan_report_t* report, void* user_data);
+
+/**
+ * @brief Raw scan report iterator to pass to blecon_scan_get_data(), with the uploader as user data
+ *
+ * @param report the report
+ * @param user_data the scan uploader instance
+ */
+void blecon_zephyr_scan_uploader_raw_scan_report_iterator(const struct blecon_modem_raw_scan_report_t* report, void* user_data);
+
+/**
+ * @brief Close the current batch, for instance when the scan completes
+ *
+ * @param uploader the scan uploader instance
+ */
+void blecon_zephyr_scan_uploader_flush(struct blecon_zephyr_scan_uploader_t* uploader);
+
+/**
+ * @brief Get the number of records dropped because the uploader was full or not connected
+ *
+ * @param uploader the scan uploader instance
+ * @return the number of records dropped
+ */
+uint32_t blecon_zephyr_scan_uploader_get_dropped_count(struct blecon_zephyr_scan_uploader_t* uploader);
+
+/**
+ * @brief Get the user data associated with the scan uploader
+ *
+ * @param uploader the scan uploader instance
+ * @return a pointer to the user data
+ */
+void* blecon_zephyr_scan_uploader_get_user_data(struct blecon_zephyr_scan_uploader_t* uploader);
+
+#ifdef __cplusplus
+}
+#endif
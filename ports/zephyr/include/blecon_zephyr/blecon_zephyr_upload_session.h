@@ -0,0 +1,182 @@
+/*
+ * Copyright (c) Blecon Ltd
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "blecon/blecon.h"
+#include "blecon/blecon_defs.h"
+#include "blecon/blecon_request.h"
+#include "blecon/port/blecon_event_loop.h"
+
+#include "blecon_zephyr_request_writer.h"
+
+#define BLECON_ZEPHYR_UPLOAD_SESSION_HEADER_VERSION 1
+#define BLECON_ZEPHYR_UPLOAD_SESSION_HEADER_SZ      (1 + BLECON_UUID_SZ + 4 + 4)
+
+struct blecon_zephyr_upload_session_t;
+
+/**
+ * @brief Callbacks structure for upload sessions
+ */
+struct blecon_zephyr_upload_session_callbacks_t {
+    /**
+     * @brief Called to read the data to upload
+     * @param session the upload session instance
+     * @param offset the offset of the data to read
+     * @param data the buffer to fill
+     * @param max_sz the maximum number of bytes to write to the buffer
+     * @return the number of bytes written to the buffer, or 0 if no data is available yet
+     */
+    size_t (*on_read)(struct blecon_zephyr_upload_session_t* session, size_t offset, uint8_t* data, size_t max_sz);
+
+    /**
+     * @brief Called when a segment has been acknowledged, or NULL
+     * @param session the upload session instance
+     * @param offset the number of bytes acknowledged from the start of the upload
+     */
+    void (*on_progress)(struct blecon_zephyr_upload_session_t* session, size_t offset);
+
+    /**
+     * @brief Called when the upload has completed, or when it has been interrupted, or NULL
+     * @param session the upload session instance
+     * @param success true if all the data has been acknowledged; if false the upload can be resumed with blecon_zephyr_upload_session_resume()
+     */
+    void (*on_done)(struct blecon_zephyr_upload_session_t* session, bool success);
+};
+
+/**
+ * @brief Structure representing an upload session
+ *
+ * An upload session sends a large payload as a sequence of one-way requests (segments) of at most segment_sz bytes.
+ * Each segment starts with a header (BLECON_ZEPHYR_UPLOAD_SESSION_HEADER_SZ bytes): the header version (1 byte),
+ * the session ID (BLECON_UUID_SZ bytes), the segment's offset (4 bytes, little-endian) and the upload's total size
+ * (4 bytes, little-endian). If the connection drops, the upload resumes from the end of the last acknowledged segment.
+ */
+struct blecon_zephyr_upload_session_t {
+    /** The Blecon instance used to submit requests */
+    struct blecon_t* blecon;
+
+    /** The request used for segments */
+    struct blecon_request_t request;
+
+    /** The writer used to stream segments */
+    struct blecon_zephyr_request_writer_t writer;
+
+    /** Callbacks for upload session operations */
+    const struct blecon_zephyr_upload_session_callbacks_t* callbacks;
+
+    /** User data to be passed to callbacks */
+    void* user_data;
+
+    /** The maximum number of bytes of data in a segment */
+    size_t segment_sz;
+
+    /** The session's ID */
+    uint8_t session_id[BLECON_UUID_SZ];
+
+    /** The total size of the upload */
+    size_t total_sz;
+
+    /** The number of bytes acknowledged */
+    size_t acknowledged_offset;
+
+    /** The offset of the end of the current segment */
+    size_t segment_end;
+
+    /** The offset of the next byte to read */
+    size_t read_offset;
+
+    /** The current segment's header */
+    uint8_t header[BLECON_ZEPHYR_UPLOAD_SESSION_HEADER_SZ];
+
+    /** The number of header bytes passed to the writer */
+    size_t header_pos;
+
+    /** Flag indicating if the upload is in progress */
+    bool uploading;
+
+    /** Flag indicating if the segment request has been submitted and has not closed yet */
+    bool request_open;
+
+    /** Flag indicating if sending the current segment's data failed */
+    bool segment_failed;
+
+    /** Event used to submit segments from the event loop */
+    struct blecon_event_t* next_segment_event;
+};
+
+/**
+ * @brief Initialize an upload session
+ *
+ * @param session the upload session instance to initialize
+ * @param event_loop the event loop to use
+ * @param blecon the Blecon instance to use to submit requests
+ * @param request_namespace the namespace of segment requests
+ * @param request_method the method of segment requests
+ * @param buffer the ring buffer used by the writer
+ * @param buffer_sz the size of the ring buffer
+ * @param chunk_sz the maximum size of a single send data operation (maximum BLECON_MTU)
+ * @param segment_sz the maximum number of bytes of data in a segment
+ * @param callbacks a pointer to the callback functions for upload session operations
+ * @param user_data user data to pass to the callbacks
+ */
+void blecon_zephyr_upload_session_init(struct blecon_zephyr_upload_session_t* session, struct blecon_event_loop_t* event_loop, struct blecon_t* blecon,
+    const char* request_namespace, const char* request_method,
+    uint8_t* buffer, size_t buffer_sz, size_t chunk_sz, size_t segment_sz,
+    const struct blecon_zephyr_upload_session_callbacks_t* callbacks, void* user_data);
+
+/**
+ * @brief Start an upload
+ *
+ * The session ID and acknowledged offset can be persisted by the application to resume an upload after a reset.
+ *
+ * @param session the upload session instance
+ * @param session_id the session's ID
+ * @param total_sz the total size of the upload
+ * @param offset the offset to start from (0 for a new upload)
+ */
+void blecon_zephyr_upload_session_start(struct blecon_zephyr_upload_session_t* session, const uint8_t* session_id, size_t total_sz, size_t offset);
+
+/**
+ * @brief Resume an interrupted upload from the last acknowledged offset
+ *
+ * @param session the upload session instance
+ */
+void blecon_zephyr_upload_session_resume(struct blecon_zephyr_upload_session_t* session);
+
+/**
+ * @brief Notify the session that on_read() can return more data
+ *
+ * @param session the upload session instance
+ */
+void blecon_zephyr_upload_session_data_available(struct blecon_zephyr_upload_session_t* session);
+
+/**
+ * @brief Get the number of bytes acknowledged from the start of the upload
+ *
+ * @param session the upload session instance
+ * @return the acknowledged offset
+ */
+size_t blecon_zephyr_upload_session_get_acknowledged_offset(struct blecon_zephyr_upload_session_t* session);
+
+/**
+ * @brief Get the user data associated with the upload session
+ *
+ * @param session the upload session instance
+ * @return a pointer to the user data
+ */
+void* blecon_zephyr_upload_session_get_user_data(struct blecon_zephyr_upload_session_t* session);
+
+#ifdef __cplusplus
+}
+#endif
@@ -49,7 +49,7 @@ struct blecon_modem_t* blecon_zephyr_get_modem(void) {
     struct blecon_bluetooth_t* bluetooth = blecon_zephyr_bluetooth_init(_event_loop);
 
     // Init Crypto port
-    struct blecon_crypto_t* crypto = blecon_zephyr_crypto_init();
+    struct blecon_crypto_t* crypto = blecon_zephyr_crypto_init(event_loop);
 
     // Init NVM port
     struct blecon_nvm_t* nvm = blecon_zephyr_nvm_init();
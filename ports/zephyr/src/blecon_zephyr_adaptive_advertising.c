@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) Blecon Ltd
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/util.h>
+
+#include "string.h"
+
+#include "blecon/blecon.h"
+#include "blecon/blecon_error.h"
+
+#include "blecon_zephyr_adaptive_advertising.h"
+
+LOG_MODULE_REGISTER(blecon_adaptive_advertising);
+
+#define BLECON_ADAPTIVE_ADVERTISING_RETRY_DELAY_MS 1000
+
+static bool blecon_zephyr_adaptive_advertising_set_mode(struct blecon_zephyr_adaptive_advertising_t* adaptive_advertising, enum blecon_advertising_mode_t mode);
+static void blecon_zephyr_adaptive_advertising_start_step(struct blecon_zephyr_adaptive_advertising_t* adaptive_advertising, size_t step);
+static void blecon_zephyr_adaptive_advertising_start_connecting(struct blecon_zephyr_adaptive_advertising_t* adaptive_advertising);
+
+// Timer and event
+static void blecon_zephyr_adaptive_advertising_decay_timer_expiry(struct k_timer* timer);
+static void blecon_zephyr_adaptive_advertising_decay_event(struct blecon_event_t* event, void* user_data);
+
+void blecon_zephyr_adaptive_advertising_init(struct blecon_zephyr_adaptive_advertising_t* adaptive_advertising, struct blecon_event_loop_t* event_loop,
+    struct blecon_t* blecon, const struct blecon_zephyr_adaptive_advertising_step_t* steps, size_t steps_count, enum blecon_advertising_mode_t idle_mode) {
+    memset(adaptive_advertising, 0, sizeof(struct blecon_zephyr_adaptive_advertising_t));
+    adaptive_advertising->blecon = blecon;
+    adaptive_advertising->steps = steps;
+    adaptive_advertising->steps_count = steps_count;
+    adaptive_advertising->idle_mode = idle_mode;
+    adaptive_advertising->step = steps_count;
+
+    k_timer_init(&adaptive_advertising->decay_timer, blecon_zephyr_adaptive_advertising_decay_timer_expiry, NULL);
+    k_timer_user_data_set(&adaptive_advertising->decay_timer, adaptive_advertising);
+    adaptive_advertising->decay_event = blecon_event_loop_register_event(event_loop, blecon_zephyr_adaptive_advertising_decay_event, adaptive_advertising);
+
+    adaptive_advertising->current_mode = idle_mode;
+    adaptive_advertising->mode_set = false;
+    blecon_zephyr_adaptive_advertising_start_step(adaptive_advertising, steps_count);
+}
+
+void blecon_zephyr_adaptive_advertising_work_pending(struct blecon_zephyr_adaptive_advertising_t* adaptive_advertising) {
+    adaptive_advertising->work_pending_count++;
+    k_timer_stop(&adaptive_advertising->decay_timer);
+    adaptive_advertising->step = 0;
+    blecon_zephyr_adaptive_advertising_set_mode(adaptive_advertising, blecon_advertising_mode_high_performance);
+
+    if(!adaptive_advertising->connecting && !blecon_is_connected(adaptive_advertising->blecon)) {
+        blecon_zephyr_adaptive_advertising_start_connecting(adaptive_advertising);
+    }
+}
+
+void blecon_zephyr_adaptive_advertising_work_done(struct blecon_zephyr_adaptive_advertising_t* adaptive_advertising) {
+    if(adaptive_advertising->work_pending_count == 0) {
+        return;
+    }
+    adaptive_advertising->work_pending_count--;
+    if(adaptive_advertising->work_pending_count > 0) {
+        // Other work is still pending
+        return;
+    }
+    adaptive_advertising->connecting = false;
+    blecon_zephyr_adaptive_advertising_start_step(adaptive_advertising, 0);
+}
+
+void blecon_zephyr_adaptive_advertising_on_connection(struct blecon_zephyr_adaptive_advertising_t* adaptive_advertising) {
+    if(!adaptive_advertising->connecting) {
+        return;
+    }
+    adaptive_advertising->connecting = false;
+
+    // Exponential moving average, weight 1/4
+    uint32_t latency_ms = (uint32_t)(k_uptime_get() - adaptive_advertising->connecting_since);
+    if(adaptive_advertising->average_connection_latency_ms == 0) {
+        adaptive_advertising->average_connection_latency_ms = MAX(latency_ms, 1);
+    } else {
+        adaptive_advertising->average_connection_latency_ms = MAX((adaptive_advertising->average_connection_latency_ms * 3 + latency_ms) / 4, 1);
+    }
+}
+
+void blecon_zephyr_adaptive_advertising_on_disconnection(struct blecon_zephyr_adaptive_advertising_t* adaptive_advertising) {
+    adaptive_advertising->connecting = false;
+    if(adaptive_advertising->work_pending_count > 0) {
+        // Work is still pending, so a new connection will be needed
+        blecon_zephyr_adaptive_advertising_start_connecting(adaptive_advertising);
+    }
+}
+
+uint32_t blecon_zephyr_adaptive_advertising_get_average_connection_latency(struct blecon_zephyr_adaptive_advertising_t* adaptive_advertising) {
+    return adaptive_advertising->average_connection_latency_ms;
+}
+
+bool blecon_zephyr_adaptive_advertising_set_mode(struct blecon_zephyr_adaptive_advertising_t* adaptive_advertising, enum blecon_advertising_mode_t mode) {
+    if(adaptive_advertising->mode_set && (mode == adaptive_advertising->current_mode)) {
+        return true;
+    }
+    if(!blecon_set_advertising_mode(adaptive_advertising->blecon, mode)) {
+        // Keep the previous mode, the change is retried on the next step
+        LOG_WRN("Could not set advertising mode %d", (int)mode);
+        return false;
+    }
+    adaptive_advertising->current_mode = mode;
+    adaptive_advertising->mode_set = true;
+    return true;
+}
+
+void blecon_zephyr_adaptive_advertising_start_step(struct blecon_zephyr_adaptive_advertising_t* adaptive_advertising, size_t step) {
+    adaptive_advertising->step = MIN(step, adaptive_advertising->steps_count);
+    if(step >= adaptive_advertising->steps_count) {
+        if(!blecon_zephyr_adaptive_advertising_set_mode(adaptive_advertising, adaptive_advertising->idle_mode)) {
+            // There is no next step, so retry later
+            k_timer_start(&adaptive_advertising->decay_timer, K_MSEC(BLECON_ADAPTIVE_ADVERTISING_RETRY_DELAY_MS), K_NO_WAIT);
+        }
+        return;
+    }
+
+    const struct blecon_zephyr_adaptive_advertising_step_t* current_step = &adaptive_advertising->steps[step];
+    blecon_zephyr_adaptive_advertising_set_mode(adaptive_advertising, current_step->mode);
+
+    // Decay faster when hotspots connect faster than the reference latency
+    uint32_t duration_ms = current_step->duration_ms;
+    uint32_t latency_ms = adaptive_advertising->average_connection_latency_ms;
+    if((latency_ms > 0) && (latency_ms < CONFIG_BLECON_ADAPTIVE_ADVERTISING_REFERENCE_LATENCY_MS)) {
+        latency_ms = MAX(latency_ms, CONFIG_BLECON_ADAPTIVE_ADVERTISING_REFERENCE_LATENCY_MS / 4);
+        duration_ms = (uint32_t)(((uint64_t)duration_ms * latency_ms) / CONFIG_BLECON_ADAPTIVE_ADVERTISING_REFERENCE_LATENCY_MS);
+    }
+
+    k_timer_start(&adaptive_advertising->decay_timer, K_MSEC(duration_ms), K_NO_WAIT);
+}
+
+void blecon_zephyr_adaptive_advertising_start_connecting(struct blecon_zephyr_adaptive_advertising_t* adaptive_advertising) {
+    adaptive_advertising->connecting = true;
+    adaptive_advertising->connecting_since = k_uptime_get();
+}
+
+void blecon_zephyr_adaptive_advertising_decay_timer_expiry(struct k_timer* timer) {
+    struct blecon_zephyr_adaptive_advertising_t* adaptive_advertising = (struct blecon_zephyr_adaptive_advertising_t*)k_timer_user_data_get(timer);
+    blecon_event_signal(adaptive_advertising->decay_event);
+}
+
+void blecon_zephyr_adaptive_advertising_decay_event(struct blecon_event_t* event, void* user_data) {
+    struct blecon_zephyr_adaptive_advertising_t* adaptive_advertising = (struct blecon_zephyr_adaptive_advertising_t*)user_data;
+
+    // Work may have become pending, or the curve restarted, since the timer expired
+    if((adaptive_advertising->work_pending_count > 0) || (k_timer_remaining_get(&adaptive_advertising->decay_timer) > 0)) {
+        return;
+    }
+
+    blecon_zephyr_adaptive_advertising_start_step(adaptive_advertising, adaptive_advertising->step + 1);
+}
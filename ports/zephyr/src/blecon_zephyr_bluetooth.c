@@ -22,6 +22,7 @@
 #include "zephyr/bluetooth/hci.h"
 #include "zephyr/random/random.h"
 #include "zephyr/sys/byteorder.h"
+#include "zephyr/sys/util.h"
 
 #if defined(CONFIG_BT_CTLR_TX_PWR_PLUS_8)
 #define BLUETOOTH_TX_POWER 8
@@ -58,6 +59,16 @@
 #define BLUETOOTH_TX_POWER 0
 #endif
 
+#define SCAN_WINDOW_MIN 4 // 2.5 ms
+
+BUILD_ASSERT( (CONFIG_BLECON_ZEPHYR_BLUETOOTH_SCAN_WINDOW <= CONFIG_BLECON_ZEPHYR_BLUETOOTH_SCAN_INTERVAL),
+    "The 1M PHY scan window must not be larger than the scan interval" );
+
+// A coded PHY parameter set to 0 falls back to the 1M PHY's
+BUILD_ASSERT( ((CONFIG_BLECON_ZEPHYR_BLUETOOTH_SCAN_WINDOW_CODED ? CONFIG_BLECON_ZEPHYR_BLUETOOTH_SCAN_WINDOW_CODED : CONFIG_BLECON_ZEPHYR_BLUETOOTH_SCAN_WINDOW)
+    <= (CONFIG_BLECON_ZEPHYR_BLUETOOTH_SCAN_INTERVAL_CODED ? CONFIG_BLECON_ZEPHYR_BLUETOOTH_SCAN_INTERVAL_CODED : CONFIG_BLECON_ZEPHYR_BLUETOOTH_SCAN_INTERVAL)),
+    "The coded PHY scan window must not be larger than the scan interval" );
+
 
 struct blecon_zephyr_bluetooth_t;
 
@@ -79,12 +90,21 @@ static void blecon_zephyr_bluetooth_scan_stop(struct blecon_bluetooth_t* bluetoo
 
 static void blecon_zephyr_bluetooth_on_connected(struct bt_conn* conn, uint8_t conn_err);
 static void blecon_zephyr_bluetooth_on_disconnected(struct bt_conn* conn, uint8_t reason);
+static void blecon_zephyr_bluetooth_on_le_param_updated(struct bt_conn* conn, uint16_t interval, uint16_t latency, uint16_t timeout);
 static void blecon_zephyr_bluetooth_on_scan_report_received(const struct bt_le_scan_recv_info* info, struct net_buf_simple* buf);
 static void ble_read_conn_rssi(uint16_t handle, int8_t* rssi);
+static void blecon_zephyr_bluetooth_scan_duty_cycle_timer_expiry(struct k_timer* timer);
+static void blecon_zephyr_bluetooth_scan_duty_cycle_event(struct blecon_event_t* event, void* user_data);
+static void blecon_zephyr_bluetooth_scan_update_event(struct blecon_event_t* event, void* user_data);
+static void blecon_zephyr_bluetooth_scan_update(struct blecon_zephyr_bluetooth_t* zephyr_bluetooth);
+static void blecon_zephyr_bluetooth_scan_shape_window(uint16_t conn_interval, uint16_t* window);
+static void blecon_zephyr_bluetooth_account_scan(struct blecon_zephyr_bluetooth_t* zephyr_bluetooth, struct blecon_zephyr_bluetooth_radio_stats_t* stats, int64_t now);
+static void blecon_zephyr_bluetooth_account_advertising(struct blecon_zephyr_bluetooth_advertising_set_t* zephyr_adv_set, struct blecon_zephyr_bluetooth_radio_stats_t* stats, int64_t now);
 
 static struct bt_conn_cb zephyr_bluetooth_callbacks = {
     .connected = blecon_zephyr_bluetooth_on_connected,
-    .disconnected = blecon_zephyr_bluetooth_on_disconnected
+    .disconnected = blecon_zephyr_bluetooth_on_disconnected,
+    .le_param_updated = blecon_zephyr_bluetooth_on_le_param_updated
 };
 
 static struct bt_le_scan_cb zephyr_bluetooth_scan_callbacks = {
@@ -94,6 +114,22 @@ static struct bt_le_scan_cb zephyr_bluetooth_scan_callbacks = {
 // Singleton
 static struct blecon_zephyr_bluetooth_t* _zephyr_bluetooth = NULL;
 
+// Scan filter, can be set before the port is initialised
+static const struct blecon_zephyr_scan_filter_t* _scan_filter = NULL;
+
+// Scan parameters, can be set before the port is initialised
+static struct blecon_zephyr_bluetooth_scan_params_t _scan_params = {
+    .interval = CONFIG_BLECON_ZEPHYR_BLUETOOTH_SCAN_INTERVAL,
+    .window = CONFIG_BLECON_ZEPHYR_BLUETOOTH_SCAN_WINDOW,
+    .interval_coded = CONFIG_BLECON_ZEPHYR_BLUETOOTH_SCAN_INTERVAL_CODED,
+    .window_coded = CONFIG_BLECON_ZEPHYR_BLUETOOTH_SCAN_WINDOW_CODED,
+    .duty_cycle_on_ms = CONFIG_BLECON_ZEPHYR_BLUETOOTH_SCAN_DUTY_CYCLE_ON_MS,
+    .duty_cycle_off_ms = CONFIG_BLECON_ZEPHYR_BLUETOOTH_SCAN_DUTY_CYCLE_OFF_MS
+};
+
+// Number of outstanding scan suspensions
+static size_t _scan_suspend_count = 0;
+
 struct blecon_bluetooth_t* blecon_zephyr_bluetooth_init(struct blecon_event_loop_t* event_loop) {
     static const struct blecon_bluetooth_fn_t bluetooth_fn = {
         .setup = blecon_zephyr_bluetooth_setup,
@@ -131,11 +167,21 @@ struct blecon_bluetooth_t* blecon_zephyr_bluetooth_init(struct blecon_event_loop
     for(size_t idx = 0; idx < BLECON_MAX_ADVERTISING_SETS; idx++) {
         zephyr_bluetooth->adv_sets[idx].identity = -1;
         zephyr_bluetooth->adv_sets[idx].handle = NULL;
+        zephyr_bluetooth->adv_sets[idx].data_valid = false;
+        zephyr_bluetooth->adv_sets[idx].running = false;
     }
     zephyr_bluetooth->adv_sets_count = 0;
 
     zephyr_bluetooth->connection.conn = NULL;
 
+    zephyr_bluetooth->scanning = false;
+    zephyr_bluetooth->scan_paused = false;
+    k_timer_init(&zephyr_bluetooth->scan_duty_cycle_timer, blecon_zephyr_bluetooth_scan_duty_cycle_timer_expiry, NULL);
+    zephyr_bluetooth->scan_duty_cycle_event = blecon_event_loop_register_event(event_loop, blecon_zephyr_bluetooth_scan_duty_cycle_event, zephyr_bluetooth);
+    zephyr_bluetooth->scan_update_event = blecon_event_loop_register_event(event_loop, blecon_zephyr_bluetooth_scan_update_event, zephyr_bluetooth);
+    zephyr_bluetooth->scan_running = false;
+    memset(&zephyr_bluetooth->radio_stats, 0, sizeof(zephyr_bluetooth->radio_stats));
+
     blecon_zephyr_bluetooth_gatt_server_init(zephyr_bluetooth);
 
     return &zephyr_bluetooth->bluetooth;
@@ -231,6 +277,11 @@ void blecon_zephyr_bluetooth_advertising_set_update_params(struct blecon_bluetoo
 
     // Set advertising parameters
     if(zephyr_adv_set->handle != NULL) {
+        // Changing the PDU type or PHY can discard the data held by the controller
+        if(adv_param.options != zephyr_adv_set->options) {
+            zephyr_adv_set->data_valid = false;
+        }
+
         // Update advertising set
         ret = bt_le_ext_adv_update_param(zephyr_adv_set->handle, &adv_param);
     } else {
@@ -238,6 +289,8 @@ void blecon_zephyr_bluetooth_advertising_set_update_params(struct blecon_bluetoo
         ret = bt_le_ext_adv_create(&adv_param, NULL, &zephyr_adv_set->handle);
     }
     blecon_assert(ret == 0);
+    zephyr_adv_set->options = adv_param.options;
+    zephyr_adv_set->interval = params->interval_0_625ms;
 
     // Update TX power
     params->tx_power = BLUETOOTH_TX_POWER;
@@ -248,21 +301,36 @@ void blecon_zephyr_bluetooth_advertising_set_update_data(struct blecon_bluetooth
 
     blecon_assert(zephyr_adv_set->handle != NULL);
 
+    blecon_assert(data->data_sz <= BLECON_ZEPHYR_BLUETOOTH_ADV_DATA_MAX_SZ);
+
+    // Skip parsing and the HCI round trip if the payload hasn't changed
+    if(zephyr_adv_set->data_valid && (zephyr_adv_set->data_sz == data->data_sz)
+        && (memcmp(zephyr_adv_set->data, data->data, data->data_sz) == 0)) {
+        return;
+    }
+
     // Set data - bit annoying, we have to re-parse our encoded advertising packet
-    struct bt_data z_adv_data[16] = {0};
+    // Parse a copy once per payload, so the AD elements remain valid while it is unchanged
+    memcpy(zephyr_adv_set->data, data->data, data->data_sz);
+    zephyr_adv_set->data_sz = data->data_sz;
+
+    struct bt_data* z_adv_data = zephyr_adv_set->z_adv_data;
     size_t z_adv_data_sz = 0;
     size_t adv_data_pos = 0;
-    while(adv_data_pos < data->data_sz) {
-        z_adv_data[z_adv_data_sz].data_len = data->data[adv_data_pos++] - 1;
-        z_adv_data[z_adv_data_sz].type = data->data[adv_data_pos++];
-        z_adv_data[z_adv_data_sz].data = &data->data[adv_data_pos];
-        blecon_assert(z_adv_data[z_adv_data_sz].data_len <= data->data_sz - adv_data_pos);
+    while(adv_data_pos < zephyr_adv_set->data_sz) {
+        blecon_assert(z_adv_data_sz < BLECON_ZEPHYR_BLUETOOTH_ADV_DATA_MAX_ELEMENTS);
+        z_adv_data[z_adv_data_sz].data_len = zephyr_adv_set->data[adv_data_pos++] - 1;
+        z_adv_data[z_adv_data_sz].type = zephyr_adv_set->data[adv_data_pos++];
+        z_adv_data[z_adv_data_sz].data = &zephyr_adv_set->data[adv_data_pos];
+        blecon_assert(z_adv_data[z_adv_data_sz].data_len <= zephyr_adv_set->data_sz - adv_data_pos);
         adv_data_pos += z_adv_data[z_adv_data_sz].data_len;
         z_adv_data_sz++;
     }
+    zephyr_adv_set->z_adv_data_count = z_adv_data_sz;
 
     int ret = bt_le_ext_adv_set_data(zephyr_adv_set->handle, z_adv_data, z_adv_data_sz, NULL, 0);
     blecon_assert(ret == 0);
+    zephyr_adv_set->data_valid = true;
 }
 
 void blecon_zephyr_bluetooth_advertising_set_start(struct blecon_bluetooth_advertising_set_t* adv_set) {
@@ -270,6 +338,11 @@ void blecon_zephyr_bluetooth_advertising_set_start(struct blecon_bluetooth_adver
 
     int ret = bt_le_ext_adv_start(zephyr_adv_set->handle, BT_LE_EXT_ADV_START_DEFAULT);
     blecon_assert(ret == 0);
+
+    if(!zephyr_adv_set->running) {
+        zephyr_adv_set->running = true;
+        zephyr_adv_set->running_since = k_uptime_get();
+    }
 }
 
 void blecon_zephyr_bluetooth_advertising_set_stop(struct blecon_bluetooth_advertising_set_t* adv_set) {
@@ -280,6 +353,11 @@ void blecon_zephyr_bluetooth_advertising_set_stop(struct blecon_bluetooth_advert
     // (because of a connection for instance)
     int ret = bt_le_ext_adv_stop(zephyr_adv_set->handle);
     blecon_assert(ret == 0);
+
+    if(zephyr_adv_set->running) {
+        blecon_zephyr_bluetooth_account_advertising(zephyr_adv_set, &_zephyr_bluetooth->radio_stats, k_uptime_get());
+        zephyr_adv_set->running = false;
+    }
 }
 
 void blecon_zephyr_bluetooth_advertising_set_free(struct blecon_bluetooth_advertising_set_t* adv_set) {
@@ -347,15 +425,17 @@ void blecon_zephyr_bluetooth_connection_free(struct blecon_bluetooth_connection_
 }
 
 void blecon_zephyr_bluetooth_scan_start(struct blecon_bluetooth_t* bluetooth, struct blecon_bluetooth_phy_mask_t phy_mask, bool active_scan) {
+    struct blecon_zephyr_bluetooth_t* zephyr_bluetooth = (struct blecon_zephyr_bluetooth_t*) bluetooth;
+
     // Set scan parameters
     struct bt_le_scan_param scan_param = {
         .type = active_scan ? BT_HCI_LE_SCAN_ACTIVE : BT_HCI_LE_SCAN_PASSIVE,
         .options = BT_LE_SCAN_OPT_NONE,
-        .interval = 128,
-        .window = 128,
+        .interval = _scan_params.interval,
+        .window = _scan_params.window,
         .timeout = 0, // No timeout
-        .interval_coded = 0,
-        .window_coded = 0,
+        .interval_coded = _scan_params.interval_coded,
+        .window_coded = _scan_params.window_coded,
     };
 
     if(phy_mask.phy_coded) {
@@ -365,13 +445,213 @@ void blecon_zephyr_bluetooth_scan_start(struct blecon_bluetooth_t* bluetooth, st
         scan_param.options |= BT_LE_SCAN_OPT_NO_1M;
     }
 
-    int ret = bt_le_scan_start(&scan_param, NULL);
-    blecon_assert(ret == 0);
+#if defined(CONFIG_BT_FILTER_ACCEPT_LIST)
+    // Let the controller drop reports from other devices
+    if((_scan_filter != NULL) && _scan_filter->use_accept_list && !_scan_filter->addrs_deny && (_scan_filter->addrs_count > 0)) {
+        int ret = bt_le_filter_accept_list_clear();
+        blecon_assert(ret == 0);
+        for(size_t p = 0; p < _scan_filter->addrs_count; p++) {
+            bt_addr_le_t bt_addr = {0};
+            bt_addr.type = _scan_filter->addrs[p].addr_type;
+            memcpy(bt_addr.a.val, _scan_filter->addrs[p].bytes, BLECON_BLUETOOTH_ADDR_SZ);
+            ret = bt_le_filter_accept_list_add(&bt_addr);
+            if(ret != 0) {
+                break; // e.g. -ENOMEM if the allow list is larger than the controller's accept list
+            }
+        }
+
+        if(ret == 0) {
+            scan_param.options |= BT_LE_SCAN_OPT_FILTER_ACCEPT_LIST;
+        } else {
+            // Fall back to the scan filter's address check, which is applied to every report anyway
+            ret = bt_le_filter_accept_list_clear();
+            blecon_assert(ret == 0);
+        }
+    }
+#endif
+
+    // Keep parameters to resume after each pause of the duty cycle, or to reshape the scan when connected
+    zephyr_bluetooth->scan_param = scan_param;
+    zephyr_bluetooth->scan_duty_cycle_on_ms = _scan_params.duty_cycle_on_ms;
+    zephyr_bluetooth->scan_duty_cycle_off_ms = _scan_params.duty_cycle_off_ms;
+    zephyr_bluetooth->scanning = true;
+    zephyr_bluetooth->scan_paused = false;
+
+    blecon_zephyr_bluetooth_scan_update(zephyr_bluetooth);
+
+    if((zephyr_bluetooth->scan_duty_cycle_on_ms > 0) && (zephyr_bluetooth->scan_duty_cycle_off_ms > 0)) {
+        k_timer_start(&zephyr_bluetooth->scan_duty_cycle_timer, K_MSEC(zephyr_bluetooth->scan_duty_cycle_on_ms), K_NO_WAIT);
+    }
 }
 
 void blecon_zephyr_bluetooth_scan_stop(struct blecon_bluetooth_t* bluetooth) {
-    int ret = bt_le_scan_stop();
-    blecon_assert(ret == 0);
+    struct blecon_zephyr_bluetooth_t* zephyr_bluetooth = (struct blecon_zephyr_bluetooth_t*) bluetooth;
+
+    k_timer_stop(&zephyr_bluetooth->scan_duty_cycle_timer);
+    zephyr_bluetooth->scanning = false;
+    zephyr_bluetooth->scan_paused = false;
+
+    blecon_zephyr_bluetooth_scan_update(zephyr_bluetooth);
+}
+
+void blecon_zephyr_bluetooth_set_scan_filter(const struct blecon_zephyr_scan_filter_t* filter) {
+    _scan_filter = filter;
+}
+
+void blecon_zephyr_bluetooth_set_scan_params(const struct blecon_zephyr_bluetooth_scan_params_t* params) {
+    blecon_assert((params->window > 0) && (params->window <= params->interval));
+    blecon_assert(params->window_coded <= ((params->interval_coded > 0) ? params->interval_coded : params->interval));
+    _scan_params = *params;
+}
+
+void blecon_zephyr_bluetooth_scan_duty_cycle_timer_expiry(struct k_timer* timer) {
+    // Scanning can't be started or stopped from the timer's context
+    blecon_event_signal(_zephyr_bluetooth->scan_duty_cycle_event);
+}
+
+void blecon_zephyr_bluetooth_scan_duty_cycle_event(struct blecon_event_t* event, void* user_data) {
+    struct blecon_zephyr_bluetooth_t* zephyr_bluetooth = (struct blecon_zephyr_bluetooth_t*) user_data;
+    if(!zephyr_bluetooth->scanning) {
+        return; // Stopped in the meantime
+    }
+
+    zephyr_bluetooth->scan_paused = !zephyr_bluetooth->scan_paused;
+    k_timer_start(&zephyr_bluetooth->scan_duty_cycle_timer,
+        K_MSEC(zephyr_bluetooth->scan_paused ? zephyr_bluetooth->scan_duty_cycle_off_ms : zephyr_bluetooth->scan_duty_cycle_on_ms), K_NO_WAIT);
+
+    blecon_zephyr_bluetooth_scan_update(zephyr_bluetooth);
+}
+
+void blecon_zephyr_bluetooth_scan_suspend(void) {
+    _scan_suspend_count++;
+    if(_zephyr_bluetooth != NULL) {
+        blecon_event_signal(_zephyr_bluetooth->scan_update_event);
+    }
+}
+
+void blecon_zephyr_bluetooth_scan_resume(void) {
+    blecon_assert(_scan_suspend_count > 0);
+    _scan_suspend_count--;
+    if(_zephyr_bluetooth != NULL) {
+        blecon_event_signal(_zephyr_bluetooth->scan_update_event);
+    }
+}
+
+void blecon_zephyr_bluetooth_get_radio_stats(struct blecon_zephyr_bluetooth_radio_stats_t* stats) {
+    struct blecon_zephyr_bluetooth_t* zephyr_bluetooth = _zephyr_bluetooth;
+    blecon_assert(zephyr_bluetooth != NULL);
+
+    blecon_event_loop_lock(zephyr_bluetooth->event_loop);
+    int64_t now = k_uptime_get();
+
+    // Include activities in progress
+    *stats = zephyr_bluetooth->radio_stats;
+    if(zephyr_bluetooth->scan_running) {
+        blecon_zephyr_bluetooth_account_scan(zephyr_bluetooth, stats, now);
+    }
+    for(size_t idx = 0; idx < zephyr_bluetooth->adv_sets_count; idx++) {
+        if(zephyr_bluetooth->adv_sets[idx].running) {
+            blecon_zephyr_bluetooth_account_advertising(&zephyr_bluetooth->adv_sets[idx], stats, now);
+        }
+    }
+    if(zephyr_bluetooth->connection.conn != NULL) {
+        stats->connected_ms += (uint32_t)(now - zephyr_bluetooth->connected_since);
+    }
+
+    blecon_event_loop_unlock(zephyr_bluetooth->event_loop);
+}
+
+void blecon_zephyr_bluetooth_reset_radio_stats(void) {
+    struct blecon_zephyr_bluetooth_t* zephyr_bluetooth = _zephyr_bluetooth;
+    blecon_assert(zephyr_bluetooth != NULL);
+
+    blecon_event_loop_lock(zephyr_bluetooth->event_loop);
+    int64_t now = k_uptime_get();
+
+    // Restart accounting of activities in progress
+    memset(&zephyr_bluetooth->radio_stats, 0, sizeof(zephyr_bluetooth->radio_stats));
+    zephyr_bluetooth->scan_running_since = now;
+    for(size_t idx = 0; idx < zephyr_bluetooth->adv_sets_count; idx++) {
+        zephyr_bluetooth->adv_sets[idx].running_since = now;
+    }
+    zephyr_bluetooth->connected_since = now;
+
+    blecon_event_loop_unlock(zephyr_bluetooth->event_loop);
+}
+
+void blecon_zephyr_bluetooth_scan_update_event(struct blecon_event_t* event, void* user_data) {
+    struct blecon_zephyr_bluetooth_t* zephyr_bluetooth = (struct blecon_zephyr_bluetooth_t*) user_data;
+    blecon_zephyr_bluetooth_scan_update(zephyr_bluetooth);
+}
+
+void blecon_zephyr_bluetooth_scan_update(struct blecon_zephyr_bluetooth_t* zephyr_bluetooth) {
+    bool run = zephyr_bluetooth->scanning && !zephyr_bluetooth->scan_paused && (_scan_suspend_count == 0);
+
+    struct bt_le_scan_param scan_param = zephyr_bluetooth->scan_param;
+    if(zephyr_bluetooth->connection.conn != NULL) {
+        // Leave room for connection events so that in-flight requests aren't slowed down
+        uint16_t window = scan_param.window;
+        blecon_zephyr_bluetooth_scan_shape_window(zephyr_bluetooth->conn_interval, &scan_param.window);
+        if((scan_param.interval_coded != 0) || (scan_param.window_coded != 0)) {
+            scan_param.window_coded = (scan_param.window_coded != 0) ? scan_param.window_coded : window;
+            blecon_zephyr_bluetooth_scan_shape_window(zephyr_bluetooth->conn_interval, &scan_param.window_coded);
+        }
+    }
+
+    if(zephyr_bluetooth->scan_running) {
+        if(run && (scan_param.window == zephyr_bluetooth->scan_running_param.window)
+            && (scan_param.window_coded == zephyr_bluetooth->scan_running_param.window_coded)) {
+            return; // Nothing to change
+        }
+
+        int ret = bt_le_scan_stop();
+        blecon_assert(ret == 0);
+        blecon_zephyr_bluetooth_account_scan(zephyr_bluetooth, &zephyr_bluetooth->radio_stats, k_uptime_get());
+        zephyr_bluetooth->scan_running = false;
+    }
+
+    if(run) {
+        zephyr_bluetooth->scan_running_param = scan_param;
+        int ret = bt_le_scan_start(&zephyr_bluetooth->scan_running_param, NULL);
+        blecon_assert(ret == 0);
+        zephyr_bluetooth->scan_running = true;
+        zephyr_bluetooth->scan_running_since = k_uptime_get();
+    }
+}
+
+void blecon_zephyr_bluetooth_scan_shape_window(uint16_t conn_interval, uint16_t* window) {
+    // The connection interval is in 1.25 ms units, the scan window in 0.625 ms units
+    uint32_t conn_interval_us = (uint32_t)conn_interval * 1250;
+    uint32_t max_window_us = 0;
+    if(conn_interval_us > CONFIG_BLECON_ZEPHYR_BLUETOOTH_SCAN_CONNECTION_GUARD_US) {
+        max_window_us = conn_interval_us - CONFIG_BLECON_ZEPHYR_BLUETOOTH_SCAN_CONNECTION_GUARD_US;
+    }
+    uint16_t max_window = MAX(max_window_us / 625, SCAN_WINDOW_MIN);
+    *window = MIN(*window, max_window);
+}
+
+void blecon_zephyr_bluetooth_account_scan(struct blecon_zephyr_bluetooth_t* zephyr_bluetooth, struct blecon_zephyr_bluetooth_radio_stats_t* stats, int64_t now) {
+    const struct bt_le_scan_param* scan_param = &zephyr_bluetooth->scan_running_param;
+    uint64_t elapsed_ms = now - zephyr_bluetooth->scan_running_since;
+    stats->scan_ms += (uint32_t)elapsed_ms;
+
+    // The receiver is on for window out of every interval
+    if(!(scan_param->options & BT_LE_SCAN_OPT_NO_1M)) {
+        stats->scan_airtime_ms += (uint32_t)(elapsed_ms * scan_param->window / scan_param->interval);
+    } else {
+        uint16_t interval_coded = (scan_param->interval_coded != 0) ? scan_param->interval_coded : scan_param->interval;
+        uint16_t window_coded = (scan_param->window_coded != 0) ? scan_param->window_coded : scan_param->window;
+        stats->scan_airtime_ms += (uint32_t)(elapsed_ms * window_coded / interval_coded);
+    }
+}
+
+void blecon_zephyr_bluetooth_account_advertising(struct blecon_zephyr_bluetooth_advertising_set_t* zephyr_adv_set, struct blecon_zephyr_bluetooth_radio_stats_t* stats, int64_t now) {
+    // Interval is in units of 0.625 ms
+    uint64_t elapsed_ms = now - zephyr_adv_set->running_since;
+    stats->advertising_ms += (uint32_t)elapsed_ms;
+    if(zephyr_adv_set->interval > 0) {
+        stats->advertising_events += (uint32_t)((elapsed_ms * 8) / (zephyr_adv_set->interval * 5ULL));
+    }
 }
 
 void blecon_zephyr_bluetooth_on_connected(struct bt_conn* conn, uint8_t conn_err) {
@@ -425,9 +705,21 @@ void blecon_zephyr_bluetooth_on_connected(struct bt_conn* conn, uint8_t conn_err
     ret = bt_conn_le_data_len_update(conn, &len_params);
     blecon_assert(ret == 0);
 
+    // The controller stops connectable advertising sets once connected
+    int64_t now = k_uptime_get();
+    if(zephyr_adv_set->running && (zephyr_adv_set->options & BT_LE_ADV_OPT_CONNECTABLE)) {
+        blecon_zephyr_bluetooth_account_advertising(zephyr_adv_set, &zephyr_bluetooth->radio_stats, now);
+        zephyr_adv_set->running = false;
+    }
+    zephyr_bluetooth->connected_since = now;
+
     // Init
     blecon_bluetooth_connection_init(&zephyr_bluetooth->connection.connection, &zephyr_bluetooth->bluetooth);
     zephyr_bluetooth->connection.conn = bt_conn_ref(conn);
+    zephyr_bluetooth->conn_interval = conn_info.le.interval;
+
+    // Reshape the scan around connection events
+    blecon_event_signal(zephyr_bluetooth->scan_update_event);
     blecon_bluetooth_on_new_connection(&zephyr_bluetooth->bluetooth, 
         &zephyr_bluetooth->connection.connection, &zephyr_adv_set->set);
     blecon_event_loop_unlock(zephyr_bluetooth->event_loop);
@@ -444,15 +736,48 @@ void blecon_zephyr_bluetooth_on_disconnected(struct bt_conn* conn, uint8_t reaso
         return;
     }
 
+    zephyr_bluetooth->radio_stats.connected_ms += (uint32_t)(k_uptime_get() - zephyr_bluetooth->connected_since);
+
     bt_conn_unref(zephyr_bluetooth->connection.conn);
     zephyr_bluetooth->connection.conn = NULL;
+    zephyr_bluetooth->conn_interval = 0;
+
+    // Restore the full scan window
+    blecon_event_signal(zephyr_bluetooth->scan_update_event);
     blecon_bluetooth_connection_on_disconnected(&zephyr_bluetooth->connection.connection);
     blecon_event_loop_unlock(zephyr_bluetooth->event_loop);
 }
 
+void blecon_zephyr_bluetooth_on_le_param_updated(struct bt_conn* conn, uint16_t interval, uint16_t latency, uint16_t timeout) {
+    struct blecon_zephyr_bluetooth_t* zephyr_bluetooth = _zephyr_bluetooth;
+
+    blecon_event_loop_lock(zephyr_bluetooth->event_loop);
+
+    // Ignore central connections
+    if( conn != zephyr_bluetooth->connection.conn ) {
+        blecon_event_loop_unlock(zephyr_bluetooth->event_loop);
+        return;
+    }
+
+    // Reshape the scan around the new connection interval
+    zephyr_bluetooth->conn_interval = interval;
+    blecon_event_signal(zephyr_bluetooth->scan_update_event);
+    blecon_event_loop_unlock(zephyr_bluetooth->event_loop);
+}
+
 void blecon_zephyr_bluetooth_on_scan_report_received(const struct bt_le_scan_recv_info* info, struct net_buf_simple* buf) {
     struct blecon_zephyr_bluetooth_t* zephyr_bluetooth = _zephyr_bluetooth;
 
+    // Filter before taking the event loop lock and copying anything
+    const struct blecon_zephyr_scan_filter_t* scan_filter = _scan_filter;
+    if(scan_filter != NULL) {
+        struct blecon_bluetooth_addr_t bt_addr = { .addr_type = info->addr->type };
+        memcpy(bt_addr.bytes, info->addr->a.val, BLECON_BLUETOOTH_ADDR_SZ);
+        if(!blecon_zephyr_scan_filter_match(scan_filter, &bt_addr, info->rssi, buf->data, buf->len)) {
+            return;
+        }
+    }
+
     blecon_event_loop_lock(zephyr_bluetooth->event_loop);
 
     struct blecon_bluetooth_advertising_info_t adv_info = {
@@ -12,12 +12,18 @@ extern "C" {
 #include "blecon/blecon_defs.h"
 
 #include "blecon/port/blecon_bluetooth.h"
+#include "blecon_zephyr/blecon_zephyr_bluetooth.h"
 #include "blecon_zephyr/blecon_zephyr_gatts_bearer.h"
 
+#include "zephyr/kernel.h"
 #include "zephyr/bluetooth/bluetooth.h"
 #include "zephyr/bluetooth/conn.h"
 
+#define BLECON_ZEPHYR_BLUETOOTH_ADV_DATA_MAX_SZ 255
+#define BLECON_ZEPHYR_BLUETOOTH_ADV_DATA_MAX_ELEMENTS 16
+
 struct blecon_event_loop_t;
+struct blecon_event_t;
 struct blecon_zephyr_bluetooth_connection_t;
 struct bt_conn;
 
@@ -25,6 +31,17 @@ struct blecon_zephyr_bluetooth_advertising_set_t {
     struct blecon_bluetooth_advertising_set_t set;
     int32_t identity;
     struct bt_le_ext_adv* handle;
+    uint32_t options;
+    uint32_t interval;
+    bool running;
+    int64_t running_since;
+
+    // Last payload set, and its AD elements (pointing into data)
+    uint8_t data[BLECON_ZEPHYR_BLUETOOTH_ADV_DATA_MAX_SZ];
+    size_t data_sz;
+    struct bt_data z_adv_data[BLECON_ZEPHYR_BLUETOOTH_ADV_DATA_MAX_ELEMENTS];
+    size_t z_adv_data_count;
+    bool data_valid;
 };
 
 struct blecon_zephyr_bluetooth_connection_t {
@@ -43,6 +60,26 @@ struct blecon_zephyr_bluetooth_t {
     struct blecon_zephyr_gatts_t gatts;
 
     struct blecon_zephyr_bluetooth_connection_t connection;
+
+    struct bt_le_scan_param scan_param;
+    uint32_t scan_duty_cycle_on_ms;
+    uint32_t scan_duty_cycle_off_ms;
+    bool scanning;
+    bool scan_paused;
+    struct k_timer scan_duty_cycle_timer;
+    struct blecon_event_t* scan_duty_cycle_event;
+    struct blecon_event_t* scan_update_event;
+
+    // Scan currently running in the controller, which may be reshaped while connected
+    bool scan_running;
+    struct bt_le_scan_param scan_running_param;
+    int64_t scan_running_since;
+
+    // Connection interval in 1.25 ms units, used to shape the scan while connected
+    uint16_t conn_interval;
+
+    int64_t connected_since;
+    struct blecon_zephyr_bluetooth_radio_stats_t radio_stats;
 };
 
 #ifdef __cplusplus
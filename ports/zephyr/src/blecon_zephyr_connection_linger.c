@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) Blecon Ltd
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/kernel.h>
+
+#include "string.h"
+
+#include "blecon/blecon.h"
+#include "blecon/blecon_error.h"
+
+#include "blecon_zephyr_connection_linger.h"
+
+static void blecon_zephyr_connection_linger_update_idle_timer(struct blecon_zephyr_connection_linger_t* linger);
+static bool blecon_zephyr_connection_linger_initiate(struct blecon_zephyr_connection_linger_t* linger);
+static void blecon_zephyr_connection_linger_update_work(struct blecon_zephyr_connection_linger_t* linger);
+
+// Timers and events
+static void blecon_zephyr_connection_linger_idle_timer_expiry(struct k_timer* timer);
+static void blecon_zephyr_connection_linger_idle_event(struct blecon_event_t* event, void* user_data);
+static void blecon_zephyr_connection_linger_connect_timer_expiry(struct k_timer* timer);
+static void blecon_zephyr_connection_linger_connect_timeout_event(struct blecon_event_t* event, void* user_data);
+
+void blecon_zephyr_connection_linger_init(struct blecon_zephyr_connection_linger_t* linger, struct blecon_event_loop_t* event_loop, struct blecon_t* blecon, uint32_t idle_timeout_ms,
+    const struct blecon_zephyr_connection_linger_callbacks_t* callbacks, void* user_data) {
+    memset(linger, 0, sizeof(struct blecon_zephyr_connection_linger_t));
+    linger->blecon = blecon;
+    linger->idle_timeout_ms = idle_timeout_ms;
+    linger->callbacks = callbacks;
+    linger->user_data = user_data;
+
+    k_timer_init(&linger->idle_timer, blecon_zephyr_connection_linger_idle_timer_expiry, NULL);
+    k_timer_user_data_set(&linger->idle_timer, linger);
+    linger->idle_event = blecon_event_loop_register_event(event_loop, blecon_zephyr_connection_linger_idle_event, linger);
+
+    k_timer_init(&linger->connect_timer, blecon_zephyr_connection_linger_connect_timer_expiry, NULL);
+    k_timer_user_data_set(&linger->connect_timer, linger);
+    linger->connect_timeout_event = blecon_event_loop_register_event(event_loop, blecon_zephyr_connection_linger_connect_timeout_event, linger);
+}
+
+bool blecon_zephyr_connection_linger_submit(struct blecon_zephyr_connection_linger_t* linger, struct blecon_request_t* request) {
+    if(blecon_is_connected(linger->blecon)) {
+        linger->active_requests_count++;
+        blecon_zephyr_connection_linger_update_idle_timer(linger);
+        blecon_zephyr_connection_linger_update_work(linger);
+        blecon_submit_request(linger->blecon, request);
+        return true;
+    }
+
+    if(linger->pending_requests_count == CONFIG_BLECON_CONNECTION_LINGER_MAX_PENDING_REQUESTS) {
+        return false;
+    }
+
+    if(!linger->connecting) {
+        if(!blecon_zephyr_connection_linger_initiate(linger)) {
+            return false;
+        }
+    }
+
+    linger->pending_requests[linger->pending_requests_count++] = request;
+    blecon_zephyr_connection_linger_update_work(linger);
+    return true;
+}
+
+void blecon_zephyr_connection_linger_request_closed(struct blecon_zephyr_connection_linger_t* linger) {
+    if(linger->active_requests_count > 0) {
+        linger->active_requests_count--;
+    }
+    blecon_zephyr_connection_linger_update_idle_timer(linger);
+    blecon_zephyr_connection_linger_update_work(linger);
+}
+
+void blecon_zephyr_connection_linger_on_connection(struct blecon_zephyr_connection_linger_t* linger) {
+    if(linger->connecting) {
+        k_timer_stop(&linger->connect_timer);
+        linger->last_connection_setup_time_ms = (uint32_t)(k_uptime_get() - linger->connection_initiated_at);
+        linger->connecting = false;
+    }
+
+    // Submit requests held while disconnected
+    for(size_t p = 0; p < linger->pending_requests_count; p++) {
+        linger->active_requests_count++;
+        blecon_submit_request(linger->blecon, linger->pending_requests[p]);
+    }
+    linger->pending_requests_count = 0;
+
+    blecon_zephyr_connection_linger_update_idle_timer(linger);
+}
+
+void blecon_zephyr_connection_linger_on_disconnection(struct blecon_zephyr_connection_linger_t* linger) {
+    k_timer_stop(&linger->idle_timer);
+    k_timer_stop(&linger->connect_timer);
+    linger->connecting = false;
+
+    // Requests in flight are closed with an error by the request processor, and each call to
+    // blecon_zephyr_connection_linger_request_closed() decrements the count
+
+    if(linger->pending_requests_count > 0) {
+        // Reconnect for requests submitted while the connection was being established
+        blecon_zephyr_connection_linger_initiate(linger);
+    }
+
+    blecon_zephyr_connection_linger_update_work(linger);
+}
+
+void blecon_zephyr_connection_linger_set_idle_timeout(struct blecon_zephyr_connection_linger_t* linger, uint32_t idle_timeout_ms) {
+    linger->idle_timeout_ms = idle_timeout_ms;
+    blecon_zephyr_connection_linger_update_idle_timer(linger);
+}
+
+#if defined(CONFIG_BLECON_ADAPTIVE_ADVERTISING)
+void blecon_zephyr_connection_linger_set_adaptive_advertising(struct blecon_zephyr_connection_linger_t* linger,
+    struct blecon_zephyr_adaptive_advertising_t* adaptive_advertising) {
+    linger->adaptive_advertising = adaptive_advertising;
+}
+#endif
+
+uint32_t blecon_zephyr_connection_linger_get_last_connection_setup_time(struct blecon_zephyr_connection_linger_t* linger) {
+    return linger->last_connection_setup_time_ms;
+}
+
+void* blecon_zephyr_connection_linger_get_user_data(struct blecon_zephyr_connection_linger_t* linger) {
+    return linger->user_data;
+}
+
+bool blecon_zephyr_connection_linger_initiate(struct blecon_zephyr_connection_linger_t* linger) {
+    if(!blecon_connection_initiate(linger->blecon)) {
+        return false;
+    }
+    linger->connecting = true;
+    linger->connection_initiated_at = k_uptime_get();
+    k_timer_start(&linger->connect_timer, K_MSEC(CONFIG_BLECON_CONNECTION_LINGER_CONNECT_TIMEOUT_MS), K_NO_WAIT);
+    return true;
+}
+
+void blecon_zephyr_connection_linger_update_work(struct blecon_zephyr_connection_linger_t* linger) {
+#if defined(CONFIG_BLECON_ADAPTIVE_ADVERTISING)
+    bool work_pending = (linger->active_requests_count > 0) || (linger->pending_requests_count > 0);
+    if((linger->adaptive_advertising == NULL) || (work_pending == linger->work_pending)) {
+        return;
+    }
+
+    linger->work_pending = work_pending;
+    if(work_pending) {
+        blecon_zephyr_adaptive_advertising_work_pending(linger->adaptive_advertising);
+    } else {
+        blecon_zephyr_adaptive_advertising_work_done(linger->adaptive_advertising);
+    }
+#endif
+}
+
+void blecon_zephyr_connection_linger_update_idle_timer(struct blecon_zephyr_connection_linger_t* linger) {
+    if((linger->active_requests_count == 0) && blecon_is_connected(linger->blecon)) {
+        k_timer_start(&linger->idle_timer, K_MSEC(linger->idle_timeout_ms), K_NO_WAIT);
+    } else {
+        k_timer_stop(&linger->idle_timer);
+    }
+}
+
+void blecon_zephyr_connection_linger_idle_timer_expiry(struct k_timer* timer) {
+    struct blecon_zephyr_connection_linger_t* linger = (struct blecon_zephyr_connection_linger_t*)k_timer_user_data_get(timer);
+    blecon_event_signal(linger->idle_event);
+}
+
+void blecon_zephyr_connection_linger_idle_event(struct blecon_event_t* event, void* user_data) {
+    struct blecon_zephyr_connection_linger_t* linger = (struct blecon_zephyr_connection_linger_t*)user_data;
+
+    // A request may have been submitted since the timer expired
+    if((linger->active_requests_count > 0) || (linger->pending_requests_count > 0)) {
+        return;
+    }
+
+    if(blecon_is_connected(linger->blecon)) {
+        blecon_connection_terminate(linger->blecon);
+    }
+}
+
+void blecon_zephyr_connection_linger_connect_timer_expiry(struct k_timer* timer) {
+    struct blecon_zephyr_connection_linger_t* linger = (struct blecon_zephyr_connection_linger_t*)k_timer_user_data_get(timer);
+    blecon_event_signal(linger->connect_timeout_event);
+}
+
+void blecon_zephyr_connection_linger_connect_timeout_event(struct blecon_event_t* event, void* user_data) {
+    struct blecon_zephyr_connection_linger_t* linger = (struct blecon_zephyr_connection_linger_t*)user_data;
+
+    // The connection may have been established since the timer expired
+    if(!linger->connecting || blecon_is_connected(linger->blecon)) {
+        return;
+    }
+    linger->connecting = false;
+
+    // Reset before calling back, so that requests can be submitted again from the callback
+    struct blecon_request_t* pending_requests[CONFIG_BLECON_CONNECTION_LINGER_MAX_PENDING_REQUESTS];
+    size_t pending_requests_count = linger->pending_requests_count;
+    memcpy(pending_requests, linger->pending_requests, pending_requests_count * sizeof(struct blecon_request_t*));
+    linger->pending_requests_count = 0;
+
+    // Stop the attempt, so that the next submission can initiate a new one
+    blecon_connection_terminate(linger->blecon);
+
+    for(size_t p = 0; p < pending_requests_count; p++) {
+        if(linger->callbacks->on_request_failed != NULL) {
+            linger->callbacks->on_request_failed(linger, pending_requests[p]);
+        }
+    }
+
+    blecon_zephyr_connection_linger_update_work(linger);
+}
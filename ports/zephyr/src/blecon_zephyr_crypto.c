@@ -10,7 +10,9 @@
 #include "blecon/blecon_error.h"
 #include "blecon_zephyr_aead_cipher.h"
 
+#include "zephyr/kernel.h"
 #include "zephyr/random/random.h"
+#include "zephyr/sys/util.h"
 
 #include "psa/crypto.h"
 
@@ -31,11 +33,55 @@ static bool blecon_zephyr_crypto_aead_cipher_dec_auth(struct blecon_crypto_aead_
             const uint8_t* ciphertext_mac, size_t ciphertext_mac_sz,
             const uint8_t* additional_data, size_t additional_data_sz,
             uint8_t* plaintext);
+static void blecon_zephyr_crypto_aead_cipher_enc_auth_in_place(struct blecon_crypto_aead_cipher_t* cipher, 
+            const uint8_t* nonce, size_t nonce_sz, 
+            uint8_t* data, size_t plaintext_sz, 
+            const uint8_t* additional_data, size_t additional_data_sz);
+static bool blecon_zephyr_crypto_aead_cipher_dec_auth_in_place(struct blecon_crypto_aead_cipher_t* cipher, 
+            const uint8_t* nonce, size_t nonce_sz, 
+            uint8_t* data, size_t ciphertext_mac_sz,
+            const uint8_t* additional_data, size_t additional_data_sz);
 static void blecon_zephyr_crypto_aead_cipher_free(struct blecon_crypto_aead_cipher_t* cipher);
 static void blecon_zephyr_crypto_sha256_compute(struct blecon_crypto_t* crypto, const uint8_t* in, size_t in_sz, uint8_t* hash);
 static bool blecon_zephyr_crypto_sha256_verify(struct blecon_crypto_t* crypto, const uint8_t* in, size_t in_sz, const uint8_t* hash);
 
-struct blecon_crypto_t* blecon_zephyr_crypto_init(void) {
+static struct blecon_crypto_sha256_t* blecon_zephyr_crypto_sha256_new(struct blecon_crypto_t* crypto);
+static void blecon_zephyr_crypto_sha256_update(struct blecon_crypto_sha256_t* sha256, const uint8_t* in, size_t in_sz);
+static void blecon_zephyr_crypto_sha256_finish(struct blecon_crypto_sha256_t* sha256, uint8_t* hash);
+static void blecon_zephyr_crypto_sha256_free(struct blecon_crypto_sha256_t* sha256);
+
+struct blecon_zephyr_sha256_t {
+    struct blecon_crypto_sha256_t sha256;
+    psa_hash_operation_t operation;
+};
+
+static bool blecon_zephyr_crypto_psa_generate_x25519_keypair(uint8_t* private_key, uint8_t* public_key);
+static void blecon_zephyr_crypto_postpone_keypair_pool_refill(void);
+
+#if CONFIG_BLECON_PORT_CRYPTO_RANDOM_POOL_SIZE > 0
+// Random bytes pool, only used from the event loop
+static uint8_t _random_pool[CONFIG_BLECON_PORT_CRYPTO_RANDOM_POOL_SIZE];
+static size_t _random_pool_pos = CONFIG_BLECON_PORT_CRYPTO_RANDOM_POOL_SIZE;
+#endif
+
+#if CONFIG_BLECON_PORT_CRYPTO_X25519_KEYPAIR_POOL_SIZE > 0
+// Keypair pool, refilled from the event loop once no crypto operation has run for a while
+struct blecon_zephyr_crypto_x25519_keypair_t {
+    uint8_t private_key[BLECON_X25519_PRIVATE_KEY_SZ];
+    uint8_t public_key[BLECON_X25519_PUBLIC_KEY_SZ];
+};
+
+static bool blecon_zephyr_crypto_keypair_pool_pop(uint8_t* private_key, uint8_t* public_key);
+static void blecon_zephyr_crypto_keypair_pool_timer_expiry(struct k_timer* timer);
+static void blecon_zephyr_crypto_keypair_pool_refill_event(struct blecon_event_t* event, void* user_data);
+
+static struct blecon_zephyr_crypto_x25519_keypair_t _keypair_pool[CONFIG_BLECON_PORT_CRYPTO_X25519_KEYPAIR_POOL_SIZE];
+static size_t _keypair_pool_count = 0;
+static struct k_timer _keypair_pool_timer;
+static struct blecon_event_t* _keypair_pool_refill_event = NULL;
+#endif
+
+struct blecon_crypto_t* blecon_zephyr_crypto_init(struct blecon_event_loop_t* event_loop) {
     static const struct blecon_crypto_fn_t crypto_fn = {
         .setup = blecon_zephyr_crypto_setup,
         .get_random = blecon_zephyr_crypto_get_random,
@@ -48,7 +94,13 @@ struct blecon_crypto_t* blecon_zephyr_crypto_init(void) {
         .aead_cipher_dec_auth = blecon_zephyr_crypto_aead_cipher_dec_auth,
         .aead_cipher_free = blecon_zephyr_crypto_aead_cipher_free,
         .sha256_compute = blecon_zephyr_crypto_sha256_compute,
-        .sha256_verify = blecon_zephyr_crypto_sha256_verify
+        .sha256_verify = blecon_zephyr_crypto_sha256_verify,
+        .aead_cipher_enc_auth_in_place = blecon_zephyr_crypto_aead_cipher_enc_auth_in_place,
+        .aead_cipher_dec_auth_in_place = blecon_zephyr_crypto_aead_cipher_dec_auth_in_place,
+        .sha256_new = blecon_zephyr_crypto_sha256_new,
+        .sha256_update = blecon_zephyr_crypto_sha256_update,
+        .sha256_finish = blecon_zephyr_crypto_sha256_finish,
+        .sha256_free = blecon_zephyr_crypto_sha256_free
     };
 
     struct blecon_crypto_t* crypto = BLECON_ALLOC(sizeof(struct blecon_crypto_t));
@@ -58,28 +110,76 @@ struct blecon_crypto_t* blecon_zephyr_crypto_init(void) {
 
     blecon_crypto_init(crypto, &crypto_fn);
 
+#if CONFIG_BLECON_PORT_CRYPTO_X25519_KEYPAIR_POOL_SIZE > 0
+    k_timer_init(&_keypair_pool_timer, blecon_zephyr_crypto_keypair_pool_timer_expiry, NULL);
+    _keypair_pool_refill_event = blecon_event_loop_register_event(event_loop, blecon_zephyr_crypto_keypair_pool_refill_event, NULL);
+#endif
+
     return crypto;
 }
 
 void blecon_zephyr_crypto_setup(struct blecon_crypto_t* crypto) {
     psa_status_t status = psa_crypto_init();
     blecon_assert( status == PSA_SUCCESS );
+
+    // Fill the keypair pool once setup has settled
+    blecon_zephyr_crypto_postpone_keypair_pool_refill();
 }
 
 void blecon_zephyr_crypto_get_random(struct blecon_crypto_t* crypto, uint8_t* random, size_t sz) {
+#if CONFIG_BLECON_PORT_CRYPTO_RANDOM_POOL_SIZE > 0
+    if(sz <= CONFIG_BLECON_PORT_CRYPTO_RANDOM_POOL_SIZE) {
+        while(sz > 0) {
+            if(_random_pool_pos == CONFIG_BLECON_PORT_CRYPTO_RANDOM_POOL_SIZE) {
+                if(sys_csrand_get(_random_pool, CONFIG_BLECON_PORT_CRYPTO_RANDOM_POOL_SIZE) != 0) {
+                    blecon_fatal_error();
+                }
+                _random_pool_pos = 0;
+            }
+
+            size_t chunk_sz = MIN(sz, CONFIG_BLECON_PORT_CRYPTO_RANDOM_POOL_SIZE - _random_pool_pos);
+            memcpy(random, &_random_pool[_random_pool_pos], chunk_sz);
+            memset(&_random_pool[_random_pool_pos], 0, chunk_sz); // Never hand out the same bytes twice
+            _random_pool_pos += chunk_sz;
+            random += chunk_sz;
+            sz -= chunk_sz;
+        }
+        return;
+    }
+#endif
+
    if(sys_csrand_get(random, sz) != 0) {
         blecon_fatal_error();
     }
 }
 
 uint32_t blecon_zephyr_crypto_get_random_integer(struct blecon_crypto_t* crypto, uint32_t max) {
+    // Rejection sampling, to avoid the modulo bias: discard values below 2^32 mod max
+    uint32_t threshold = (uint32_t)(-max) % max;
     uint32_t result = 0;
-    blecon_zephyr_crypto_get_random(crypto, (uint8_t*)&result, sizeof(uint32_t));
-    result %= max;
-    return result;
+    do {
+        blecon_zephyr_crypto_get_random(crypto, (uint8_t*)&result, sizeof(uint32_t));
+    } while(result < threshold);
+    return result % max;
 }
 
 bool blecon_zephyr_crypto_generate_x25519_keypair(struct blecon_crypto_t* crypto, uint8_t* private_key, uint8_t* public_key) {
+#if CONFIG_BLECON_PORT_CRYPTO_X25519_KEYPAIR_POOL_SIZE > 0
+    bool popped = blecon_zephyr_crypto_keypair_pool_pop(private_key, public_key);
+
+    // The keypair is replaced once the handshake is over
+    blecon_zephyr_crypto_postpone_keypair_pool_refill();
+
+    if(popped) {
+        return true;
+    }
+#endif
+
+    // Pool is empty or disabled, generate a keypair now
+    return blecon_zephyr_crypto_psa_generate_x25519_keypair(private_key, public_key);
+}
+
+bool blecon_zephyr_crypto_psa_generate_x25519_keypair(uint8_t* private_key, uint8_t* public_key) {
     bool success = false;
 
     // Set key parameters (X25519)
@@ -118,6 +218,7 @@ fail:
 bool blecon_zephyr_crypto_x25519_dh(struct blecon_crypto_t* crypto, const uint8_t* private_key, const uint8_t* peer_public_key, uint8_t* shared_secret) {
     bool success = false;
     psa_key_handle_t key_handle = PSA_KEY_HANDLE_INIT;
+    blecon_zephyr_crypto_postpone_keypair_pool_refill();
     
     // Set key parameters for private key (X25519)
     psa_key_attributes_t key_attributes = PSA_KEY_ATTRIBUTES_INIT;
@@ -149,68 +250,37 @@ fail:
 
 bool blecon_zephyr_crypto_hkdf_sha256(struct blecon_crypto_t* crypto, const uint8_t* secret, size_t secret_sz, const uint8_t* salt, size_t salt_sz, uint8_t* output, size_t output_sz) {
     bool success = false;
-    psa_key_handle_t input_key_handle = PSA_KEY_HANDLE_INIT;
-    psa_key_handle_t output_key_handle = PSA_KEY_HANDLE_INIT;
     psa_key_derivation_operation_t operation = PSA_KEY_DERIVATION_OPERATION_INIT;
-    
-    // Set key parameters for input secret
-    psa_key_attributes_t input_key_attributes = PSA_KEY_ATTRIBUTES_INIT;
-    psa_set_key_usage_flags(&input_key_attributes, PSA_KEY_USAGE_DERIVE);
-	psa_set_key_lifetime(&input_key_attributes, PSA_KEY_LIFETIME_VOLATILE);
-	psa_set_key_algorithm(&input_key_attributes, PSA_ALG_HKDF(PSA_ALG_SHA_256));
-	psa_set_key_type(&input_key_attributes, PSA_KEY_TYPE_DERIVE);
-	psa_set_key_bits(&input_key_attributes, secret_sz * 8);
-
-    // Import secret
-    psa_status_t status = psa_import_key(&input_key_attributes, secret, secret_sz, &input_key_handle);
-    if( status != PSA_SUCCESS ) { goto fail; }
-    
+    blecon_zephyr_crypto_postpone_keypair_pool_refill();
+
+    // The secret and output are passed as raw bytes, so no keys need to be created in the key store
+
     // Set-up key derivation
-    status = psa_key_derivation_setup(&operation, PSA_ALG_HKDF(PSA_ALG_SHA_256));
+    psa_status_t status = psa_key_derivation_setup(&operation, PSA_ALG_HKDF(PSA_ALG_SHA_256));
     if( status != PSA_SUCCESS ) { goto fail; }
 
     // Input salt
     status = psa_key_derivation_input_bytes(&operation, PSA_KEY_DERIVATION_INPUT_SALT, salt, salt_sz);
     if( status != PSA_SUCCESS ) { goto fail; }
 
-    // Input key
-    status = psa_key_derivation_input_key(&operation, PSA_KEY_DERIVATION_INPUT_SECRET, input_key_handle);
+    // Input secret
+    status = psa_key_derivation_input_bytes(&operation, PSA_KEY_DERIVATION_INPUT_SECRET, secret, secret_sz);
     if( status != PSA_SUCCESS ) { goto fail; }
 
     // Input additional info (empty)
     status = psa_key_derivation_input_bytes(&operation, PSA_KEY_DERIVATION_INPUT_INFO, NULL, 0);
     if( status != PSA_SUCCESS ) { goto fail; }
 
-    // Set key parameters for output secret
-    psa_key_attributes_t output_key_attributes = PSA_KEY_ATTRIBUTES_INIT;
-    psa_set_key_usage_flags(&output_key_attributes, PSA_KEY_USAGE_EXPORT);
-	psa_set_key_lifetime(&output_key_attributes, PSA_KEY_LIFETIME_VOLATILE);
-	psa_set_key_type(&output_key_attributes, PSA_KEY_TYPE_RAW_DATA);
-	psa_set_key_bits(&output_key_attributes, output_sz * 8);
-
-    // Store output key
-    status = psa_key_derivation_output_key(&output_key_attributes, &operation, &output_key_handle);
+    // Output secret
+    status = psa_key_derivation_output_bytes(&operation, output, output_sz);
     if( status != PSA_SUCCESS ) { goto fail; }
 
-    // Export key
-    size_t output_key_sz = 0;
-    status = psa_export_key(output_key_handle, output, output_sz, &output_key_sz);
-    if( status != PSA_SUCCESS ) { goto fail; }
-
-    blecon_assert(output_key_sz == output_sz);
-
     success = true;
 
 fail:
     // Abort operation
     psa_key_derivation_abort(&operation);
 
-    // Destroy secrets
-    status = psa_destroy_key(input_key_handle); // Ok even if key_handle is set to 0
-    blecon_assert( status == PSA_SUCCESS );
-    status = psa_destroy_key(output_key_handle); // Ok even if key_handle is set to 0
-    blecon_assert( status == PSA_SUCCESS );
-
     return success;
 }
 
@@ -231,6 +301,7 @@ struct blecon_crypto_aead_cipher_t* blecon_zephyr_crypto_aead_cipher_new(struct
 	psa_set_key_bits(&key_attributes, 256);
 
     // Import key
+    blecon_zephyr_crypto_postpone_keypair_pool_refill();
     psa_status_t status = psa_import_key(&key_attributes, key, BLECON_CHACHA20_POLY1305_SECRET_SZ, &zephyr_cipher->key_handle);
     blecon_assert( status == PSA_SUCCESS );
 
@@ -248,6 +319,7 @@ void blecon_zephyr_crypto_aead_cipher_enc_auth(struct blecon_crypto_aead_cipher_
     
     // Perform AEAD Encryption
     size_t ciphertext_mac_sz = 0;
+    blecon_zephyr_crypto_postpone_keypair_pool_refill();
     psa_status_t status = psa_aead_encrypt(zephyr_cipher->key_handle, PSA_ALG_CHACHA20_POLY1305, 
         nonce, nonce_sz, additional_data, additional_data_sz, plaintext, plaintext_sz, 
         ciphertext_mac, plaintext_sz + BLECON_CHACHA20_POLY1305_TAG_SZ, &ciphertext_mac_sz);
@@ -272,6 +344,7 @@ bool blecon_zephyr_crypto_aead_cipher_dec_auth(struct blecon_crypto_aead_cipher_
     if(ciphertext_mac_sz < BLECON_CHACHA20_POLY1305_TAG_SZ) {
         return false;
     }
+    blecon_zephyr_crypto_postpone_keypair_pool_refill();
     
     // Perform AEAD Encryption
     size_t plaintext_sz = 0;
@@ -287,10 +360,27 @@ fail:
     return success;
 }
 
+void blecon_zephyr_crypto_aead_cipher_enc_auth_in_place(struct blecon_crypto_aead_cipher_t* cipher, 
+            const uint8_t* nonce, size_t nonce_sz, 
+            uint8_t* data, size_t plaintext_sz, 
+            const uint8_t* additional_data, size_t additional_data_sz) {
+    // PSA accepts identical input and output buffers
+    blecon_zephyr_crypto_aead_cipher_enc_auth(cipher, nonce, nonce_sz, data, plaintext_sz, additional_data, additional_data_sz, data);
+}
+
+bool blecon_zephyr_crypto_aead_cipher_dec_auth_in_place(struct blecon_crypto_aead_cipher_t* cipher, 
+            const uint8_t* nonce, size_t nonce_sz, 
+            uint8_t* data, size_t ciphertext_mac_sz,
+            const uint8_t* additional_data, size_t additional_data_sz) {
+    // PSA accepts identical input and output buffers
+    return blecon_zephyr_crypto_aead_cipher_dec_auth(cipher, nonce, nonce_sz, data, ciphertext_mac_sz, additional_data, additional_data_sz, data);
+}
+
 void blecon_zephyr_crypto_aead_cipher_free(struct blecon_crypto_aead_cipher_t* cipher) {
     struct blecon_zephyr_aead_cipher_t* zephyr_cipher = (struct blecon_zephyr_aead_cipher_t*)cipher;
     
     // Destroy secret
+    blecon_zephyr_crypto_postpone_keypair_pool_refill();
     psa_status_t status = psa_destroy_key(zephyr_cipher->key_handle); // Ok even if key_handle is set to 0
     blecon_assert( status == PSA_SUCCESS );
 
@@ -299,12 +389,107 @@ void blecon_zephyr_crypto_aead_cipher_free(struct blecon_crypto_aead_cipher_t* c
 
 void blecon_zephyr_crypto_sha256_compute(struct blecon_crypto_t* crypto, const uint8_t* in, size_t in_sz, uint8_t* hash) {
     size_t out_sz = 0;
+    blecon_zephyr_crypto_postpone_keypair_pool_refill();
     psa_status_t status = psa_hash_compute(PSA_ALG_SHA_256, in, in_sz, hash, BLECON_SHA256_HASH_SZ, &out_sz);
     blecon_assert( status == PSA_SUCCESS );
     blecon_assert( out_sz == BLECON_SHA256_HASH_SZ );
 }
 
 bool blecon_zephyr_crypto_sha256_verify(struct blecon_crypto_t* crypto, const uint8_t* in, size_t in_sz, const uint8_t* hash) {
+    blecon_zephyr_crypto_postpone_keypair_pool_refill();
     psa_status_t status = psa_hash_compare(PSA_ALG_SHA_256, in, in_sz, hash, BLECON_SHA256_HASH_SZ);
     return status == PSA_SUCCESS;
 }
+
+struct blecon_crypto_sha256_t* blecon_zephyr_crypto_sha256_new(struct blecon_crypto_t* crypto) {
+    struct blecon_zephyr_sha256_t* zephyr_sha256 = malloc(sizeof(struct blecon_zephyr_sha256_t));
+    blecon_assert(zephyr_sha256 != NULL);
+    blecon_crypto_sha256_init(&zephyr_sha256->sha256, crypto);
+
+    zephyr_sha256->operation = psa_hash_operation_init();
+    blecon_zephyr_crypto_postpone_keypair_pool_refill();
+    psa_status_t status = psa_hash_setup(&zephyr_sha256->operation, PSA_ALG_SHA_256);
+    blecon_assert( status == PSA_SUCCESS );
+
+    return &zephyr_sha256->sha256;
+}
+
+void blecon_zephyr_crypto_sha256_update(struct blecon_crypto_sha256_t* sha256, const uint8_t* in, size_t in_sz) {
+    struct blecon_zephyr_sha256_t* zephyr_sha256 = (struct blecon_zephyr_sha256_t*)sha256;
+
+    blecon_zephyr_crypto_postpone_keypair_pool_refill();
+    psa_status_t status = psa_hash_update(&zephyr_sha256->operation, in, in_sz);
+    blecon_assert( status == PSA_SUCCESS );
+}
+
+void blecon_zephyr_crypto_sha256_finish(struct blecon_crypto_sha256_t* sha256, uint8_t* hash) {
+    struct blecon_zephyr_sha256_t* zephyr_sha256 = (struct blecon_zephyr_sha256_t*)sha256;
+
+    size_t out_sz = 0;
+    blecon_zephyr_crypto_postpone_keypair_pool_refill();
+    psa_status_t status = psa_hash_finish(&zephyr_sha256->operation, hash, BLECON_SHA256_HASH_SZ, &out_sz);
+    blecon_assert( status == PSA_SUCCESS );
+    blecon_assert( out_sz == BLECON_SHA256_HASH_SZ );
+
+    free(zephyr_sha256);
+}
+
+void blecon_zephyr_crypto_sha256_free(struct blecon_crypto_sha256_t* sha256) {
+    struct blecon_zephyr_sha256_t* zephyr_sha256 = (struct blecon_zephyr_sha256_t*)sha256;
+
+    blecon_zephyr_crypto_postpone_keypair_pool_refill();
+    psa_hash_abort(&zephyr_sha256->operation);
+
+    free(zephyr_sha256);
+}
+
+#if CONFIG_BLECON_PORT_CRYPTO_X25519_KEYPAIR_POOL_SIZE > 0
+bool blecon_zephyr_crypto_keypair_pool_pop(uint8_t* private_key, uint8_t* public_key) {
+    if(_keypair_pool_count == 0) {
+        return false;
+    }
+
+    _keypair_pool_count--;
+    struct blecon_zephyr_crypto_x25519_keypair_t* keypair = &_keypair_pool[_keypair_pool_count];
+    memcpy(private_key, keypair->private_key, BLECON_X25519_PRIVATE_KEY_SZ);
+    memcpy(public_key, keypair->public_key, BLECON_X25519_PUBLIC_KEY_SZ);
+
+    // Keypairs must only be used once
+    memset(keypair, 0, sizeof(struct blecon_zephyr_crypto_x25519_keypair_t));
+
+    return true;
+}
+
+void blecon_zephyr_crypto_postpone_keypair_pool_refill(void) {
+    // Restarting the timer pushes the refill back until crypto operations have stopped
+    if(_keypair_pool_count < CONFIG_BLECON_PORT_CRYPTO_X25519_KEYPAIR_POOL_SIZE) {
+        k_timer_start(&_keypair_pool_timer, K_MSEC(CONFIG_BLECON_PORT_CRYPTO_X25519_KEYPAIR_POOL_REFILL_DELAY_MS), K_NO_WAIT);
+    }
+}
+
+void blecon_zephyr_crypto_keypair_pool_timer_expiry(struct k_timer* timer) {
+    blecon_event_signal(_keypair_pool_refill_event);
+}
+
+void blecon_zephyr_crypto_keypair_pool_refill_event(struct blecon_event_t* event, void* user_data) {
+    // A crypto operation may have run since the timer expired
+    if((_keypair_pool_count == CONFIG_BLECON_PORT_CRYPTO_X25519_KEYPAIR_POOL_SIZE) || (k_timer_remaining_get(&_keypair_pool_timer) > 0)) {
+        return;
+    }
+
+    struct blecon_zephyr_crypto_x25519_keypair_t* keypair = &_keypair_pool[_keypair_pool_count];
+    if(!blecon_zephyr_crypto_psa_generate_x25519_keypair(keypair->private_key, keypair->public_key)) {
+        memset(keypair, 0, sizeof(struct blecon_zephyr_crypto_x25519_keypair_t));
+        return; // Keypairs will be generated on demand
+    }
+    _keypair_pool_count++;
+
+    // Generate one keypair per event, so that other events are processed in between
+    if(_keypair_pool_count < CONFIG_BLECON_PORT_CRYPTO_X25519_KEYPAIR_POOL_SIZE) {
+        blecon_event_signal(_keypair_pool_refill_event);
+    }
+}
+#else
+void blecon_zephyr_crypto_postpone_keypair_pool_refill(void) {
+}
+#endif
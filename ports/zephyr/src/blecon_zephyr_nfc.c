@@ -29,7 +29,12 @@ static void blecon_zephyr_nfc_stop(struct blecon_nfc_t* nfc);
 struct blecon_zephyr_nfc_t {
     struct blecon_nfc_t nfc;
     uint8_t ndef_buffer[256];
+    size_t ndef_sz;
+    uint8_t message[256];
+    size_t message_sz;
     bool nfc_active;
+    blecon_zephyr_nfc_field_on_callback_t field_on_callback;
+    void* field_on_user_data;
 };
 
 struct blecon_nfc_t* blecon_zephyr_nfc_init(void) {
@@ -48,13 +53,17 @@ struct blecon_nfc_t* blecon_zephyr_nfc_init(void) {
     blecon_nfc_init(&zephyr_nfc->nfc, &nfc_fn);
 
     memset(zephyr_nfc->ndef_buffer, 0, sizeof(zephyr_nfc->ndef_buffer));
+    zephyr_nfc->ndef_sz = 0;
+    zephyr_nfc->message_sz = 0;
     zephyr_nfc->nfc_active = false;
+    zephyr_nfc->field_on_callback = NULL;
+    zephyr_nfc->field_on_user_data = NULL;
 
     return &zephyr_nfc->nfc;
 }
 
 void blecon_zephyr_nfc_setup(struct blecon_nfc_t* nfc) {
-    int ret = nfc_t2t_setup(nfc_callback, NULL);
+    int ret = nfc_t2t_setup(nfc_callback, nfc);
     if(ret) {
         blecon_fatal_error();
     }
@@ -63,6 +72,19 @@ void blecon_zephyr_nfc_setup(struct blecon_nfc_t* nfc) {
 void blecon_zephyr_nfc_set_message(struct blecon_nfc_t* nfc, const uint8_t* nfc_data, size_t nfc_data_sz) {
     struct blecon_zephyr_nfc_t* zephyr_nfc = (struct blecon_zephyr_nfc_t*) nfc;
 
+    // The NDEF message is only encoded when the URI changes
+    if((zephyr_nfc->ndef_sz > 0) && (zephyr_nfc->message_sz == nfc_data_sz)
+        && (memcmp(zephyr_nfc->message, nfc_data, nfc_data_sz) == 0)) {
+        return;
+    }
+
+    if(nfc_data_sz > sizeof(zephyr_nfc->message)) {
+        blecon_fatal_error();
+    }
+    memcpy(zephyr_nfc->message, nfc_data, nfc_data_sz);
+    zephyr_nfc->message_sz = nfc_data_sz;
+    zephyr_nfc->ndef_sz = 0;
+
     bool nfc_active = zephyr_nfc->nfc_active;
     if(nfc_active) {
         blecon_zephyr_nfc_stop(nfc);
@@ -90,6 +112,7 @@ void blecon_zephyr_nfc_set_message(struct blecon_nfc_t* nfc, const uint8_t* nfc_
     if(ret) {
         blecon_fatal_error();
     }
+    zephyr_nfc->ndef_sz = len;
 
     if(nfc_active) {
         blecon_zephyr_nfc_start(nfc);
@@ -118,7 +141,27 @@ void blecon_zephyr_nfc_stop(struct blecon_nfc_t* nfc) {
     zephyr_nfc->nfc_active = false;
 }
 
+void blecon_zephyr_nfc_set_field_on_callback(struct blecon_nfc_t* nfc, blecon_zephyr_nfc_field_on_callback_t callback, void* user_data) {
+    struct blecon_zephyr_nfc_t* zephyr_nfc = (struct blecon_zephyr_nfc_t*) nfc;
+
+    zephyr_nfc->field_on_callback = callback;
+    zephyr_nfc->field_on_user_data = user_data;
+}
+
+const uint8_t* blecon_zephyr_nfc_get_ndef_message(struct blecon_nfc_t* nfc, size_t* sz) {
+    struct blecon_zephyr_nfc_t* zephyr_nfc = (struct blecon_zephyr_nfc_t*) nfc;
+
+    *sz = zephyr_nfc->ndef_sz;
+    return (zephyr_nfc->ndef_sz > 0) ? zephyr_nfc->ndef_buffer : NULL;
+}
+
 static void nfc_callback(void* context, nfc_t2t_event_t event, const uint8_t* data, size_t data_length) {
+    struct blecon_zephyr_nfc_t* zephyr_nfc = (struct blecon_zephyr_nfc_t*) context;
+
+    blecon_zephyr_nfc_field_on_callback_t callback = zephyr_nfc->field_on_callback;
+    if((event == NFC_T2T_EVENT_FIELD_ON) && (callback != NULL)) {
+        callback(&zephyr_nfc->nfc, zephyr_nfc->field_on_user_data);
+    }
 }
 
 #else
@@ -152,4 +195,12 @@ void blecon_zephyr_nfc_start(struct blecon_nfc_t* nfc) {
 void blecon_zephyr_nfc_stop(struct blecon_nfc_t* nfc) {
 }
 
+void blecon_zephyr_nfc_set_field_on_callback(struct blecon_nfc_t* nfc, blecon_zephyr_nfc_field_on_callback_t callback, void* user_data) {
+}
+
+const uint8_t* blecon_zephyr_nfc_get_ndef_message(struct blecon_nfc_t* nfc, size_t* sz) {
+    *sz = 0;
+    return NULL;
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,281 @@
+/*
+ * Copyright (c) Blecon Ltd
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <zephyr/kernel.h>
+#include <zephyr/fs/fcb.h>
+#include <zephyr/storage/flash_map.h>
+
+#include "string.h"
+
+#include "blecon/blecon.h"
+#include "blecon/blecon_error.h"
+
+#include "blecon_zephyr_outbox.h"
+#include "blecon_zephyr_request_batcher.h"
+
+#include "pm_config.h"
+
+#define BLECON_OUTBOX_FLASH_AREA_ID     PM_BLECON_OUTBOX_ID
+#define BLECON_OUTBOX_FCB_MAGIC         0x424C4F58 // "BLOX"
+#define BLECON_OUTBOX_FCB_VERSION       1
+#define BLECON_OUTBOX_MAX_WRITE_ALIGN   16
+#define BLECON_OUTBOX_BATCH_MAX_AGE_MS  1000
+
+static void blecon_zephyr_outbox_send_next(struct blecon_zephyr_outbox_t* outbox);
+static void blecon_zephyr_outbox_release_sectors(struct blecon_zephyr_outbox_t* outbox);
+static void blecon_zephyr_outbox_record_failed(struct blecon_zephyr_outbox_t* outbox, const struct fcb_entry* loc);
+static void blecon_zephyr_outbox_drain_failed(struct blecon_zephyr_outbox_t* outbox);
+
+// Batcher callbacks
+static void blecon_zephyr_outbox_batcher_on_message_sent(struct blecon_zephyr_request_batcher_t* batcher, struct blecon_zephyr_request_batcher_message_t* message, bool sent);
+static void blecon_zephyr_outbox_batcher_on_connection_required(struct blecon_zephyr_request_batcher_t* batcher);
+
+const static struct blecon_zephyr_request_batcher_callbacks_t batcher_callbacks = {
+    .on_message_sent = blecon_zephyr_outbox_batcher_on_message_sent,
+    .on_connection_required = blecon_zephyr_outbox_batcher_on_connection_required
+};
+
+void blecon_zephyr_outbox_init(struct blecon_zephyr_outbox_t* outbox, struct blecon_event_loop_t* event_loop, struct blecon_t* blecon,
+    const char* request_namespace, const char* request_method, const char* request_content_type,
+    uint8_t* batch_buffer, size_t batch_buffer_sz,
+    const struct blecon_zephyr_outbox_callbacks_t* callbacks, void* user_data) {
+    memset(outbox, 0, sizeof(struct blecon_zephyr_outbox_t));
+    outbox->callbacks = callbacks;
+    outbox->user_data = user_data;
+
+    blecon_zephyr_request_batcher_init(&outbox->batcher, event_loop, blecon,
+        request_namespace, request_method, request_content_type,
+        batch_buffer, batch_buffer_sz, batch_buffer_sz / 2, BLECON_OUTBOX_BATCH_MAX_AGE_MS,
+        &batcher_callbacks, outbox);
+
+    // Any record must fit in a batch, including its length prefix
+    blecon_assert(outbox->batcher.batch_buffer_sz >= CONFIG_BLECON_OUTBOX_MAX_RECORD_SZ + 2);
+
+    // Set up flash circular buffer
+    uint32_t sector_count = CONFIG_BLECON_OUTBOX_MAX_SECTORS;
+    int ret = flash_area_get_sectors(BLECON_OUTBOX_FLASH_AREA_ID, &sector_count, outbox->sectors);
+    blecon_assert(ret == 0);
+
+    outbox->fcb.f_magic = BLECON_OUTBOX_FCB_MAGIC;
+    outbox->fcb.f_version = BLECON_OUTBOX_FCB_VERSION;
+    outbox->fcb.f_sector_cnt = sector_count;
+    outbox->fcb.f_scratch_cnt = 0;
+    outbox->fcb.f_sectors = outbox->sectors;
+    ret = fcb_init(BLECON_OUTBOX_FLASH_AREA_ID, &outbox->fcb);
+    blecon_assert(ret == 0);
+    blecon_assert(outbox->fcb.f_align <= BLECON_OUTBOX_MAX_WRITE_ALIGN);
+
+    // Start from the oldest record
+    outbox->send_loc.fe_sector = NULL;
+    outbox->sent_loc.fe_sector = NULL;
+}
+
+bool blecon_zephyr_outbox_push(struct blecon_zephyr_outbox_t* outbox, const uint8_t* data, size_t sz) {
+    blecon_assert(sz <= CONFIG_BLECON_OUTBOX_MAX_RECORD_SZ);
+
+    struct fcb_entry loc;
+    int ret = fcb_append(&outbox->fcb, sz, &loc);
+    if(ret == -ENOSPC) {
+        return false;
+    }
+    blecon_assert(ret == 0);
+
+    // Writes must be aligned to the flash's write block size
+    size_t aligned_sz = sz - (sz % outbox->fcb.f_align);
+    if(aligned_sz > 0) {
+        ret = flash_area_write(outbox->fcb.fap, FCB_ENTRY_FA_DATA_OFF(loc), data, aligned_sz);
+        blecon_assert(ret == 0);
+    }
+    if(aligned_sz < sz) {
+        uint8_t tail[BLECON_OUTBOX_MAX_WRITE_ALIGN];
+        memset(tail, flash_area_erased_val(outbox->fcb.fap), sizeof(tail));
+        memcpy(tail, data + aligned_sz, sz - aligned_sz);
+        ret = flash_area_write(outbox->fcb.fap, FCB_ENTRY_FA_DATA_OFF(loc) + aligned_sz, tail, outbox->fcb.f_align);
+        blecon_assert(ret == 0);
+    }
+
+    ret = fcb_append_finish(&outbox->fcb, &loc);
+    blecon_assert(ret == 0);
+
+    return true;
+}
+
+void blecon_zephyr_outbox_drain(struct blecon_zephyr_outbox_t* outbox) {
+    outbox->draining = true;
+    blecon_zephyr_outbox_send_next(outbox);
+}
+
+bool blecon_zephyr_outbox_is_empty(struct blecon_zephyr_outbox_t* outbox) {
+    struct fcb_entry loc = outbox->sent_loc;
+    return fcb_getnext(&outbox->fcb, &loc) != 0;
+}
+
+uint32_t blecon_zephyr_outbox_get_skipped_count(struct blecon_zephyr_outbox_t* outbox) {
+    return outbox->skipped_count;
+}
+
+#if defined(CONFIG_BLECON_ADAPTIVE_ADVERTISING)
+void blecon_zephyr_outbox_set_adaptive_advertising(struct blecon_zephyr_outbox_t* outbox,
+    struct blecon_zephyr_adaptive_advertising_t* adaptive_advertising) {
+    // Records are sent through the batcher, which tracks whether work is pending
+    blecon_zephyr_request_batcher_set_adaptive_advertising(&outbox->batcher, adaptive_advertising);
+}
+#endif
+
+void* blecon_zephyr_outbox_get_user_data(struct blecon_zephyr_outbox_t* outbox) {
+    return outbox->user_data;
+}
+
+void blecon_zephyr_outbox_send_next(struct blecon_zephyr_outbox_t* outbox) {
+    if(!outbox->draining) {
+        return;
+    }
+
+    // After a failure, only flush the records already batched until they have all completed
+    bool more = true;
+    size_t max_messages = outbox->isolating ? 1 : CONFIG_BLECON_OUTBOX_MAX_MESSAGES_IN_FLIGHT;
+    while(!outbox->failed && (outbox->messages_count < max_messages)) {
+        struct fcb_entry loc = outbox->send_loc;
+        if(fcb_getnext(&outbox->fcb, &loc) != 0) {
+            more = false;
+            break;
+        }
+
+        blecon_assert(loc.fe_data_len <= CONFIG_BLECON_OUTBOX_MAX_RECORD_SZ);
+        int ret = flash_area_read(outbox->fcb.fap, FCB_ENTRY_FA_DATA_OFF(loc), outbox->record_buffer, loc.fe_data_len);
+        blecon_assert(ret == 0);
+
+        struct blecon_zephyr_outbox_message_t* message = &outbox->messages[(outbox->messages_first + outbox->messages_count) % CONFIG_BLECON_OUTBOX_MAX_MESSAGES_IN_FLIGHT];
+        message->loc = loc;
+        message->sent = false;
+        message->complete = false;
+        if(!blecon_zephyr_request_batcher_send(&outbox->batcher, &message->message, outbox->record_buffer, loc.fe_data_len, message)) {
+            // Both batches are busy, carry on when one completes
+            break;
+        }
+
+        outbox->messages_count++;
+        outbox->send_loc = loc;
+    }
+
+    if(!more && (outbox->messages_count == 0)) {
+        outbox->draining = false;
+        if(outbox->callbacks->on_drained != NULL) {
+            outbox->callbacks->on_drained(outbox, true);
+        }
+        return;
+    }
+
+    // Don't wait for the batch to fill up
+    blecon_zephyr_request_batcher_flush(&outbox->batcher);
+}
+
+void blecon_zephyr_outbox_release_sectors(struct blecon_zephyr_outbox_t* outbox) {
+    // All the records in sectors older than the last sent record's have been sent
+    while(outbox->fcb.f_oldest != outbox->sent_loc.fe_sector) {
+        int ret = fcb_rotate(&outbox->fcb);
+        blecon_assert(ret == 0);
+    }
+}
+
+void blecon_zephyr_outbox_batcher_on_message_sent(struct blecon_zephyr_request_batcher_t* batcher, struct blecon_zephyr_request_batcher_message_t* message, bool sent) {
+    struct blecon_zephyr_outbox_t* outbox = (struct blecon_zephyr_outbox_t*)blecon_zephyr_request_batcher_get_user_data(batcher);
+    struct blecon_zephyr_outbox_message_t* outbox_message = CONTAINER_OF(message, struct blecon_zephyr_outbox_message_t, message);
+
+    outbox_message->complete = true;
+    outbox_message->sent = sent;
+    if(!sent) {
+        // Stop until the application drains the outbox again
+        outbox->draining = false;
+    }
+
+    // Records are only marked as sent in order
+    while(outbox->messages_count > 0) {
+        struct blecon_zephyr_outbox_message_t* first = &outbox->messages[outbox->messages_first];
+        if(!first->complete) {
+            break;
+        }
+        if(!outbox->failed) {
+            if(first->sent) {
+                outbox->sent_loc = first->loc;
+                if(!outbox->isolating) {
+                    outbox->retries = 0;
+                }
+            } else {
+                outbox->failed = true;
+                blecon_zephyr_outbox_record_failed(outbox, &first->loc);
+            }
+        }
+        outbox->messages_first = (outbox->messages_first + 1) % CONFIG_BLECON_OUTBOX_MAX_MESSAGES_IN_FLIGHT;
+        outbox->messages_count--;
+    }
+
+    if(outbox->sent_loc.fe_sector != NULL) {
+        blecon_zephyr_outbox_release_sectors(outbox);
+    }
+
+    if(outbox->failed) {
+        // Records waiting in the batcher's current batch can't be sent in order either
+        blecon_zephyr_request_batcher_discard(&outbox->batcher);
+
+        // The discarded messages may already have completed the failure
+        if(outbox->failed && (outbox->messages_count == 0)) {
+            blecon_zephyr_outbox_drain_failed(outbox);
+        }
+        return;
+    }
+
+    blecon_zephyr_outbox_send_next(outbox);
+}
+
+void blecon_zephyr_outbox_record_failed(struct blecon_zephyr_outbox_t* outbox, const struct fcb_entry* loc) {
+    if(!blecon_is_connected(outbox->batcher.blecon)) {
+        // The connection was lost, which is not the records' fault
+        return;
+    }
+
+    if(outbox->isolating) {
+        // The record was sent on its own, so it is the one failing: skip it
+        outbox->sent_loc = *loc;
+        outbox->skipped_count++;
+        outbox->isolating = false;
+        outbox->retries = 0;
+        outbox->resume = true;
+        return;
+    }
+
+    outbox->retries++;
+    if(outbox->retries >= CONFIG_BLECON_OUTBOX_MAX_RETRIES) {
+        outbox->isolating = true;
+    }
+}
+
+void blecon_zephyr_outbox_drain_failed(struct blecon_zephyr_outbox_t* outbox) {
+    // Send unsent records again, from the record after the skipped one or next time
+    outbox->send_loc = outbox->sent_loc;
+    outbox->failed = false;
+
+    if(outbox->resume) {
+        // The failing record was skipped, carry on with the next ones
+        outbox->resume = false;
+        outbox->draining = true;
+        blecon_zephyr_outbox_send_next(outbox);
+        return;
+    }
+
+    outbox->draining = false;
+
+    if(outbox->callbacks->on_drained != NULL) {
+        outbox->callbacks->on_drained(outbox, false);
+    }
+}
+
+void blecon_zephyr_outbox_batcher_on_connection_required(struct blecon_zephyr_request_batcher_t* batcher) {
+    struct blecon_zephyr_outbox_t* outbox = (struct blecon_zephyr_outbox_t*)blecon_zephyr_request_batcher_get_user_data(batcher);
+    if(outbox->callbacks->on_connection_required != NULL) {
+        outbox->callbacks->on_connection_required(outbox);
+    }
+}
@@ -0,0 +1,241 @@
+/*
+ * Copyright (c) Blecon Ltd
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/util.h>
+
+#include "string.h"
+
+#include "blecon/blecon.h"
+#include "blecon/blecon_defs.h"
+#include "blecon/blecon_error.h"
+#include "blecon/blecon_list.h"
+#include "blecon/blecon_request.h"
+
+#include "blecon_zephyr_request_batcher.h"
+
+#define VARINT_MAX_SZ 5
+
+static size_t blecon_zephyr_request_batcher_encode_varint(uint8_t* buffer, uint32_t value);
+static void blecon_zephyr_request_batcher_complete_batch(struct blecon_zephyr_request_batcher_batch_t* batch, bool sent);
+static void blecon_zephyr_request_batcher_update_work(struct blecon_zephyr_request_batcher_t* batcher);
+
+// Request callbacks
+static void blecon_zephyr_request_batcher_request_on_closed(struct blecon_request_t* request);
+static void blecon_zephyr_request_batcher_request_on_data_sent(struct blecon_request_send_data_op_t* send_data_op, bool data_sent);
+
+// Timer and event
+static void blecon_zephyr_request_batcher_age_timer_expiry(struct k_timer* timer);
+static void blecon_zephyr_request_batcher_flush_event(struct blecon_event_t* event, void* user_data);
+
+const static struct blecon_request_callbacks_t request_callbacks = {
+    .on_closed = blecon_zephyr_request_batcher_request_on_closed,
+    .on_data_sent = blecon_zephyr_request_batcher_request_on_data_sent,
+    .alloc_incoming_data_buffer = NULL,
+    .on_data_received = NULL
+};
+
+void blecon_zephyr_request_batcher_init(struct blecon_zephyr_request_batcher_t* batcher, struct blecon_event_loop_t* event_loop, struct blecon_t* blecon,
+    const char* request_namespace, const char* request_method, const char* request_content_type,
+    uint8_t* buffer, size_t buffer_sz, size_t flush_sz, uint32_t max_age_ms,
+    const struct blecon_zephyr_request_batcher_callbacks_t* callbacks, void* user_data) {
+    memset(batcher, 0, sizeof(struct blecon_zephyr_request_batcher_t));
+    batcher->blecon = blecon;
+    batcher->callbacks = callbacks;
+    batcher->user_data = user_data;
+    batcher->batch_buffer_sz = MIN(buffer_sz / 2, BLECON_MTU);
+    batcher->flush_sz = MIN(flush_sz, batcher->batch_buffer_sz);
+    batcher->max_age_ms = max_age_ms;
+    blecon_assert(batcher->batch_buffer_sz > VARINT_MAX_SZ);
+
+    batcher->request_parameters.oneway = true;
+    batcher->request_parameters.namespace = request_namespace;
+    batcher->request_parameters.method = request_method;
+    batcher->request_parameters.request_content_type = request_content_type;
+    batcher->request_parameters.response_content_type = NULL;
+    batcher->request_parameters.response_mtu = 0;
+    batcher->request_parameters.callbacks = &request_callbacks;
+    batcher->request_parameters.user_data = batcher;
+
+    for(size_t p = 0; p < 2; p++) {
+        struct blecon_zephyr_request_batcher_batch_t* batch = &batcher->batches[p];
+        batch->batcher = batcher;
+        batch->buffer = buffer + p * batcher->batch_buffer_sz;
+        batch->sz = 0;
+        batch->in_flight = false;
+        blecon_list_init(&batch->messages);
+        blecon_request_init(&batch->request, &batcher->request_parameters);
+    }
+    batcher->current_batch = 0;
+
+    k_timer_init(&batcher->age_timer, blecon_zephyr_request_batcher_age_timer_expiry, NULL);
+    k_timer_user_data_set(&batcher->age_timer, batcher);
+    batcher->flush_event = blecon_event_loop_register_event(event_loop, blecon_zephyr_request_batcher_flush_event, batcher);
+}
+
+bool blecon_zephyr_request_batcher_send(struct blecon_zephyr_request_batcher_t* batcher, struct blecon_zephyr_request_batcher_message_t* message,
+    const uint8_t* data, size_t sz, void* user_data) {
+    uint8_t header[VARINT_MAX_SZ];
+    size_t header_sz = blecon_zephyr_request_batcher_encode_varint(header, sz);
+    if(header_sz + sz > batcher->batch_buffer_sz) {
+        // Would never fit
+        return false;
+    }
+
+    struct blecon_zephyr_request_batcher_batch_t* batch = &batcher->batches[batcher->current_batch];
+    if(!batch->in_flight && (batch->sz + header_sz + sz > batcher->batch_buffer_sz)) {
+        // Send the current batch and move on to the other one
+        blecon_zephyr_request_batcher_flush(batcher);
+        batch = &batcher->batches[batcher->current_batch];
+    }
+
+    if(batch->in_flight || (batch->sz + header_sz + sz > batcher->batch_buffer_sz)) {
+        return false;
+    }
+
+    memcpy(batch->buffer + batch->sz, header, header_sz);
+    memcpy(batch->buffer + batch->sz + header_sz, data, sz);
+    batch->sz += header_sz + sz;
+
+    message->user_data = user_data;
+    blecon_list_node_init(&message->node);
+    blecon_list_push_back(&batch->messages, &message->node);
+    blecon_zephyr_request_batcher_update_work(batcher);
+
+    if(batch->sz >= batcher->flush_sz) {
+        blecon_zephyr_request_batcher_flush(batcher);
+    } else if(blecon_list_size(&batch->messages) == 1) {
+        k_timer_start(&batcher->age_timer, K_MSEC(batcher->max_age_ms), K_NO_WAIT);
+    }
+
+    return true;
+}
+
+void blecon_zephyr_request_batcher_flush(struct blecon_zephyr_request_batcher_t* batcher) {
+    struct blecon_zephyr_request_batcher_batch_t* batch = &batcher->batches[batcher->current_batch];
+    if(batch->in_flight || blecon_list_is_empty(&batch->messages)) {
+        return;
+    }
+
+    if(!blecon_is_connected(batcher->blecon)) {
+        // Keep the batch until we're connected
+        if(batcher->callbacks->on_connection_required != NULL) {
+            batcher->callbacks->on_connection_required(batcher);
+        }
+        return;
+    }
+
+    k_timer_stop(&batcher->age_timer);
+
+    blecon_request_cleanup(&batch->request);
+    if(!blecon_request_send_data(&batch->send_op, &batch->request, batch->buffer, batch->sz, true, batch)) {
+        blecon_zephyr_request_batcher_complete_batch(batch, false);
+        return;
+    }
+
+    batch->in_flight = true;
+    batcher->current_batch = (batcher->current_batch + 1) % 2;
+
+    blecon_submit_request(batcher->blecon, &batch->request);
+}
+
+void blecon_zephyr_request_batcher_discard(struct blecon_zephyr_request_batcher_t* batcher) {
+    struct blecon_zephyr_request_batcher_batch_t* batch = &batcher->batches[batcher->current_batch];
+    if(batch->in_flight || blecon_list_is_empty(&batch->messages)) {
+        return;
+    }
+
+    k_timer_stop(&batcher->age_timer);
+    blecon_zephyr_request_batcher_complete_batch(batch, false);
+}
+
+#if defined(CONFIG_BLECON_ADAPTIVE_ADVERTISING)
+void blecon_zephyr_request_batcher_set_adaptive_advertising(struct blecon_zephyr_request_batcher_t* batcher,
+    struct blecon_zephyr_adaptive_advertising_t* adaptive_advertising) {
+    batcher->adaptive_advertising = adaptive_advertising;
+}
+#endif
+
+void* blecon_zephyr_request_batcher_get_user_data(struct blecon_zephyr_request_batcher_t* batcher) {
+    return batcher->user_data;
+}
+
+size_t blecon_zephyr_request_batcher_encode_varint(uint8_t* buffer, uint32_t value) {
+    size_t sz = 0;
+    do {
+        uint8_t byte = value & 0x7F;
+        value >>= 7;
+        if(value != 0) {
+            byte |= 0x80;
+        }
+        buffer[sz++] = byte;
+    } while(value != 0);
+    return sz;
+}
+
+void blecon_zephyr_request_batcher_complete_batch(struct blecon_zephyr_request_batcher_batch_t* batch, bool sent) {
+    struct blecon_zephyr_request_batcher_t* batcher = batch->batcher;
+
+    // Reset batch before calling back, so that messages can be re-queued from the callback
+    struct blecon_list_t messages = batch->messages;
+    blecon_list_init(&batch->messages);
+    batch->sz = 0;
+    batch->in_flight = false;
+
+    struct blecon_list_node_t* node = blecon_list_pop_front(&messages);
+    while(node != NULL) {
+        struct blecon_zephyr_request_batcher_message_t* message = CONTAINER_OF(node, struct blecon_zephyr_request_batcher_message_t, node);
+        if(batcher->callbacks->on_message_sent != NULL) {
+            batcher->callbacks->on_message_sent(batcher, message, sent);
+        }
+        node = blecon_list_pop_front(&messages);
+    }
+
+    // Messages may have been queued again from the callbacks
+    blecon_zephyr_request_batcher_update_work(batcher);
+}
+
+void blecon_zephyr_request_batcher_update_work(struct blecon_zephyr_request_batcher_t* batcher) {
+#if defined(CONFIG_BLECON_ADAPTIVE_ADVERTISING)
+    bool work_pending = !blecon_list_is_empty(&batcher->batches[0].messages) || !blecon_list_is_empty(&batcher->batches[1].messages);
+    if((batcher->adaptive_advertising == NULL) || (work_pending == batcher->work_pending)) {
+        return;
+    }
+
+    batcher->work_pending = work_pending;
+    if(work_pending) {
+        blecon_zephyr_adaptive_advertising_work_pending(batcher->adaptive_advertising);
+    } else {
+        blecon_zephyr_adaptive_advertising_work_done(batcher->adaptive_advertising);
+    }
+#endif
+}
+
+void blecon_zephyr_request_batcher_request_on_closed(struct blecon_request_t* request) {
+    struct blecon_zephyr_request_batcher_batch_t* batch = CONTAINER_OF(request, struct blecon_zephyr_request_batcher_batch_t, request);
+    struct blecon_zephyr_request_batcher_t* batcher = batch->batcher;
+
+    blecon_zephyr_request_batcher_complete_batch(batch, blecon_request_get_status(request) == blecon_request_status_ok);
+
+    // The other batch may have filled up in the meantime
+    struct blecon_zephyr_request_batcher_batch_t* current = &batcher->batches[batcher->current_batch];
+    if(current->sz >= batcher->flush_sz) {
+        blecon_zephyr_request_batcher_flush(batcher);
+    }
+}
+
+void blecon_zephyr_request_batcher_request_on_data_sent(struct blecon_request_send_data_op_t* send_data_op, bool data_sent) {
+    // Completion is reported when the request is closed
+}
+
+void blecon_zephyr_request_batcher_age_timer_expiry(struct k_timer* timer) {
+    struct blecon_zephyr_request_batcher_t* batcher = (struct blecon_zephyr_request_batcher_t*)k_timer_user_data_get(timer);
+    blecon_event_signal(batcher->flush_event);
+}
+
+void blecon_zephyr_request_batcher_flush_event(struct blecon_event_t* event, void* user_data) {
+    struct blecon_zephyr_request_batcher_t* batcher = (struct blecon_zephyr_request_batcher_t*)user_data;
+    blecon_zephyr_request_batcher_flush(batcher);
+}
@@ -0,0 +1,332 @@
+/*
+ * Copyright (c) Blecon Ltd
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/util.h>
+
+#include "string.h"
+
+#include "blecon/blecon_defs.h"
+#include "blecon/blecon_error.h"
+#include "blecon/blecon_request.h"
+#include "blecon/port/blecon_event_loop.h"
+
+#include "blecon_zephyr_request_writer.h"
+
+static bool blecon_zephyr_request_writer_can_queue(struct blecon_zephyr_request_writer_t* writer);
+static bool blecon_zephyr_request_writer_urgent_requests_pending(void);
+static void blecon_zephyr_request_writer_pump_bulk_writers(void);
+static void blecon_zephyr_request_writer_fill(struct blecon_zephyr_request_writer_t* writer);
+static void blecon_zephyr_request_writer_pump(struct blecon_zephyr_request_writer_t* writer);
+static void blecon_zephyr_request_writer_complete(struct blecon_zephyr_request_writer_t* writer, bool success);
+
+// Request callbacks
+static void blecon_zephyr_request_writer_on_data_sent(struct blecon_request_send_data_op_t* send_data_op, bool data_sent);
+
+// Quantum timer and event
+static void blecon_zephyr_request_writer_quantum_timer_expiry(struct k_timer* timer);
+static void blecon_zephyr_request_writer_quantum_event(struct blecon_event_t* event, void* user_data);
+
+static struct blecon_request_t* _urgent_requests[CONFIG_BLECON_REQUEST_WRITER_MAX_URGENT_REQUESTS] = {0};
+static struct blecon_list_t _bulk_writers = {0};
+static struct k_timer _quantum_timer;
+static struct blecon_event_t* _quantum_event = NULL;
+
+void blecon_zephyr_request_writer_urgent_requests_init(struct blecon_event_loop_t* event_loop) {
+    blecon_list_init(&_bulk_writers);
+    k_timer_init(&_quantum_timer, blecon_zephyr_request_writer_quantum_timer_expiry, NULL);
+    _quantum_event = blecon_event_loop_register_event(event_loop, blecon_zephyr_request_writer_quantum_event, NULL);
+}
+
+void blecon_zephyr_request_writer_init(struct blecon_zephyr_request_writer_t* writer, struct blecon_request_t* request,
+    const struct blecon_request_parameters_t* parameters, uint8_t* buffer, size_t buffer_sz, size_t chunk_sz,
+    const struct blecon_zephyr_request_writer_callbacks_t* callbacks, void* user_data) {
+    blecon_assert(buffer_sz > 0);
+    blecon_assert((chunk_sz > 0) && (chunk_sz <= BLECON_MTU));
+
+    // A writer re-initialised at the bulk priority must leave the list before its node is cleared
+    if(writer->priority == blecon_zephyr_request_writer_priority_bulk) {
+        blecon_list_remove(&_bulk_writers, &writer->bulk_writers_list_node);
+    }
+
+    memset(writer, 0, sizeof(struct blecon_zephyr_request_writer_t));
+    writer->request = request;
+    writer->callbacks = callbacks;
+    writer->user_data = user_data;
+    writer->buffer = buffer;
+    writer->buffer_sz = buffer_sz;
+    writer->chunk_sz = chunk_sz;
+    writer->max_ops_in_flight = CONFIG_BLECON_REQUEST_WRITER_MAX_OPS_IN_FLIGHT;
+    writer->priority = blecon_zephyr_request_writer_priority_normal;
+    blecon_list_node_init(&writer->bulk_writers_list_node);
+
+    // Nothing is sent until the writer is started
+    writer->done = true;
+
+    for(size_t p = 0; p < CONFIG_BLECON_REQUEST_WRITER_MAX_OPS_IN_FLIGHT; p++) {
+        writer->ops[p].writer = writer;
+    }
+
+    // Route on_data_sent to the writer
+    writer->request_callbacks = *parameters->callbacks;
+    writer->request_callbacks.on_data_sent = blecon_zephyr_request_writer_on_data_sent;
+    writer->request_parameters = *parameters;
+    writer->request_parameters.callbacks = &writer->request_callbacks;
+
+    blecon_request_init(request, &writer->request_parameters);
+}
+
+void blecon_zephyr_request_writer_start(struct blecon_zephyr_request_writer_t* writer) {
+    writer->head = 0;
+    writer->send_pos = 0;
+    writer->tail = 0;
+    writer->closed = false;
+    writer->finished_queued = false;
+    writer->done = false;
+    writer->ops_first = 0;
+    writer->ops_count = 0;
+    writer->quantum_available = false;
+
+    blecon_zephyr_request_writer_pump(writer);
+}
+
+size_t blecon_zephyr_request_writer_write(struct blecon_zephyr_request_writer_t* writer, const uint8_t* data, size_t sz) {
+    blecon_assert(!writer->closed);
+
+    size_t written = 0;
+    while(written < sz) {
+        size_t free_sz = writer->buffer_sz - (writer->head - writer->tail);
+        if(free_sz == 0) {
+            break;
+        }
+        size_t offset = writer->head % writer->buffer_sz;
+        size_t copy_sz = MIN(MIN(free_sz, writer->buffer_sz - offset), sz - written);
+        memcpy(writer->buffer + offset, data + written, copy_sz);
+        writer->head += copy_sz;
+        written += copy_sz;
+    }
+
+    blecon_zephyr_request_writer_pump(writer);
+
+    return written;
+}
+
+void blecon_zephyr_request_writer_close(struct blecon_zephyr_request_writer_t* writer) {
+    writer->closed = true;
+    blecon_zephyr_request_writer_pump(writer);
+}
+
+void blecon_zephyr_request_writer_data_available(struct blecon_zephyr_request_writer_t* writer) {
+    blecon_zephyr_request_writer_pump(writer);
+}
+
+void blecon_zephyr_request_writer_set_priority(struct blecon_zephyr_request_writer_t* writer, enum blecon_zephyr_request_writer_priority_t priority) {
+    if(priority == writer->priority) {
+        return;
+    }
+    writer->priority = priority;
+
+    // Bulk writers are tracked so that they can be resumed when urgent requests end
+    if(priority == blecon_zephyr_request_writer_priority_bulk) {
+        blecon_assert(_quantum_event != NULL);
+        blecon_list_push_back(&_bulk_writers, &writer->bulk_writers_list_node);
+    } else {
+        blecon_list_remove(&_bulk_writers, &writer->bulk_writers_list_node);
+        blecon_zephyr_request_writer_pump(writer);
+    }
+}
+
+bool blecon_zephyr_request_writer_begin_urgent_request(struct blecon_request_t* request) {
+    blecon_assert(_quantum_event != NULL);
+
+    bool was_pending = blecon_zephyr_request_writer_urgent_requests_pending();
+    for(size_t p = 0; p < CONFIG_BLECON_REQUEST_WRITER_MAX_URGENT_REQUESTS; p++) {
+        if(_urgent_requests[p] == NULL) {
+            _urgent_requests[p] = request;
+            if(!was_pending) {
+                k_timer_start(&_quantum_timer, K_MSEC(CONFIG_BLECON_REQUEST_WRITER_BULK_QUANTUM_MS), K_MSEC(CONFIG_BLECON_REQUEST_WRITER_BULK_QUANTUM_MS));
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+void blecon_zephyr_request_writer_end_urgent_request(struct blecon_request_t* request) {
+    for(size_t p = 0; p < CONFIG_BLECON_REQUEST_WRITER_MAX_URGENT_REQUESTS; p++) {
+        if(_urgent_requests[p] == request) {
+            _urgent_requests[p] = NULL;
+        }
+    }
+    if(!blecon_zephyr_request_writer_urgent_requests_pending()) {
+        k_timer_stop(&_quantum_timer);
+        blecon_zephyr_request_writer_pump_bulk_writers();
+    }
+}
+
+void blecon_zephyr_request_writer_clear_urgent_requests(void) {
+    memset(_urgent_requests, 0, sizeof(_urgent_requests));
+    k_timer_stop(&_quantum_timer);
+    blecon_zephyr_request_writer_pump_bulk_writers();
+}
+
+size_t blecon_zephyr_request_writer_get_bytes_sent(struct blecon_zephyr_request_writer_t* writer) {
+    return writer->tail;
+}
+
+size_t blecon_zephyr_request_writer_get_free_space(struct blecon_zephyr_request_writer_t* writer) {
+    return writer->buffer_sz - (writer->head - writer->tail);
+}
+
+void* blecon_zephyr_request_writer_get_user_data(struct blecon_zephyr_request_writer_t* writer) {
+    return writer->user_data;
+}
+
+bool blecon_zephyr_request_writer_can_queue(struct blecon_zephyr_request_writer_t* writer) {
+    if(writer->ops_count >= writer->max_ops_in_flight) {
+        return false;
+    }
+    if((writer->priority != blecon_zephyr_request_writer_priority_bulk)
+        || (writer->ops_count < CONFIG_BLECON_REQUEST_WRITER_BULK_MAX_OPS_IN_FLIGHT_WHILE_URGENT)
+        || !blecon_zephyr_request_writer_urgent_requests_pending()) {
+        return true;
+    }
+
+    // Throttled, but a quantum lets one more chunk through so that bulk traffic is not starved
+    return writer->quantum_available;
+}
+
+bool blecon_zephyr_request_writer_urgent_requests_pending(void) {
+    bool pending = false;
+    for(size_t p = 0; p < CONFIG_BLECON_REQUEST_WRITER_MAX_URGENT_REQUESTS; p++) {
+        if(_urgent_requests[p] == NULL) {
+            continue;
+        }
+        // Urgency ends with the request, even if blecon_zephyr_request_writer_end_urgent_request() is never called
+        if(blecon_request_get_status(_urgent_requests[p]) != blecon_request_status_pending) {
+            _urgent_requests[p] = NULL;
+            continue;
+        }
+        pending = true;
+    }
+    return pending;
+}
+
+void blecon_zephyr_request_writer_pump_bulk_writers(void) {
+    struct blecon_list_node_t* node = blecon_list_iterate_start(&_bulk_writers);
+    while(node != NULL) {
+        struct blecon_zephyr_request_writer_t* writer = CONTAINER_OF(node, struct blecon_zephyr_request_writer_t, bulk_writers_list_node);
+        // The writer may change its priority, and leave the list, from its callbacks
+        node = blecon_list_iterate_next(node);
+        blecon_zephyr_request_writer_pump(writer);
+    }
+}
+
+void blecon_zephyr_request_writer_fill(struct blecon_zephyr_request_writer_t* writer) {
+    while(!writer->closed) {
+        size_t free_sz = writer->buffer_sz - (writer->head - writer->tail);
+        if(free_sz == 0) {
+            return;
+        }
+        size_t offset = writer->head % writer->buffer_sz;
+        bool finished = false;
+        size_t sz = writer->callbacks->on_read(writer, writer->buffer + offset, MIN(free_sz, writer->buffer_sz - offset), &finished);
+        writer->head += sz;
+        if(finished) {
+            writer->closed = true;
+        }
+        if(sz == 0) {
+            return;
+        }
+    }
+}
+
+void blecon_zephyr_request_writer_pump(struct blecon_zephyr_request_writer_t* writer) {
+    while(!writer->done && !writer->finished_queued && blecon_zephyr_request_writer_can_queue(writer)) {
+        if(writer->callbacks->on_read != NULL) {
+            blecon_zephyr_request_writer_fill(writer);
+        }
+
+        size_t offset = writer->send_pos % writer->buffer_sz;
+        size_t sz = MIN(MIN(writer->head - writer->send_pos, writer->chunk_sz), writer->buffer_sz - offset);
+        bool finished = writer->closed && (writer->send_pos + sz == writer->head);
+
+        if(!finished && (sz < writer->chunk_sz)) {
+            // Wait for a full chunk unless the link would otherwise be idle, or the chunk is cut by the end of the ring buffer
+            if((sz == 0) || ((writer->ops_count > 0) && (offset + sz < writer->buffer_sz))) {
+                return;
+            }
+        }
+
+        struct blecon_zephyr_request_writer_op_t* op = &writer->ops[(writer->ops_first + writer->ops_count) % CONFIG_BLECON_REQUEST_WRITER_MAX_OPS_IN_FLIGHT];
+        op->sz = sz;
+        op->complete = false;
+        if(!blecon_request_send_data(&op->op, writer->request, writer->buffer + offset, sz, finished, op)) {
+            blecon_zephyr_request_writer_complete(writer, false);
+            return;
+        }
+
+        writer->ops_count++;
+        writer->send_pos += sz;
+        writer->quantum_available = false;
+        if(finished) {
+            writer->finished_queued = true;
+        }
+    }
+}
+
+void blecon_zephyr_request_writer_complete(struct blecon_zephyr_request_writer_t* writer, bool success) {
+    if(writer->done) {
+        return;
+    }
+    writer->done = true;
+    if(writer->callbacks->on_done != NULL) {
+        writer->callbacks->on_done(writer, success);
+    }
+}
+
+void blecon_zephyr_request_writer_on_data_sent(struct blecon_request_send_data_op_t* send_data_op, bool data_sent) {
+    struct blecon_zephyr_request_writer_op_t* op = (struct blecon_zephyr_request_writer_op_t*)blecon_request_send_data_op_get_user_data(send_data_op);
+    struct blecon_zephyr_request_writer_t* writer = op->writer;
+
+    if(!data_sent) {
+        blecon_zephyr_request_writer_complete(writer, false);
+        return;
+    }
+
+    // Release operations in order, so that the ring buffer's tail only moves forward
+    op->complete = true;
+    while((writer->ops_count > 0) && writer->ops[writer->ops_first].complete) {
+        writer->tail += writer->ops[writer->ops_first].sz;
+        writer->ops_first = (writer->ops_first + 1) % CONFIG_BLECON_REQUEST_WRITER_MAX_OPS_IN_FLIGHT;
+        writer->ops_count--;
+    }
+
+    if(writer->finished_queued && (writer->ops_count == 0)) {
+        blecon_zephyr_request_writer_complete(writer, true);
+        return;
+    }
+
+    blecon_zephyr_request_writer_pump(writer);
+}
+
+void blecon_zephyr_request_writer_quantum_timer_expiry(struct k_timer* timer) {
+    blecon_event_signal(_quantum_event);
+}
+
+void blecon_zephyr_request_writer_quantum_event(struct blecon_event_t* event, void* user_data) {
+    if(!blecon_zephyr_request_writer_urgent_requests_pending()) {
+        // All urgent requests have closed
+        k_timer_stop(&_quantum_timer);
+        blecon_zephyr_request_writer_pump_bulk_writers();
+        return;
+    }
+
+    for(struct blecon_list_node_t* node = blecon_list_iterate_start(&_bulk_writers); node != NULL; node = blecon_list_iterate_next(node)) {
+        struct blecon_zephyr_request_writer_t* writer = CONTAINER_OF(node, struct blecon_zephyr_request_writer_t, bulk_writers_list_node);
+        writer->quantum_available = true;
+    }
+    blecon_zephyr_request_writer_pump_bulk_writers();
+}
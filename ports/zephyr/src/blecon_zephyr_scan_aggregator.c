@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) Blecon Ltd
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/kernel.h>
+
+#include "string.h"
+
+#include "blecon/blecon_error.h"
+
+#include "blecon_zephyr_scan_aggregator.h"
+
+#define FNV1A_32_OFFSET_BASIS   0x811c9dc5u
+#define FNV1A_32_PRIME          0x01000193u
+
+static uint32_t blecon_zephyr_scan_aggregator_fnv1a(uint32_t hash, const uint8_t* data, size_t sz);
+static size_t blecon_zephyr_scan_aggregator_bucket(const struct blecon_bluetooth_addr_t* bt_addr, uint8_t sid);
+static void blecon_zephyr_scan_aggregator_report(struct blecon_zephyr_scan_aggregator_t* aggregator, const struct blecon_zephyr_scan_aggregator_record_t* record);
+static void blecon_zephyr_scan_aggregator_lru_unlink(struct blecon_zephyr_scan_aggregator_t* aggregator, uint16_t idx);
+static void blecon_zephyr_scan_aggregator_lru_push(struct blecon_zephyr_scan_aggregator_t* aggregator, uint16_t idx);
+static void blecon_zephyr_scan_aggregator_bucket_unlink(struct blecon_zephyr_scan_aggregator_t* aggregator, uint16_t idx);
+
+void blecon_zephyr_scan_aggregator_init(struct blecon_zephyr_scan_aggregator_t* aggregator,
+    const struct blecon_zephyr_scan_aggregator_callbacks_t* callbacks, void* user_data) {
+    BUILD_ASSERT(CONFIG_BLECON_SCAN_AGGREGATOR_MAX_DEVICES < BLECON_ZEPHYR_SCAN_AGGREGATOR_INVALID_INDEX);
+
+    memset(aggregator, 0, sizeof(struct blecon_zephyr_scan_aggregator_t));
+    aggregator->callbacks = callbacks;
+    aggregator->user_data = user_data;
+
+    for(size_t b = 0; b < CONFIG_BLECON_SCAN_AGGREGATOR_MAX_DEVICES; b++) {
+        aggregator->buckets[b] = BLECON_ZEPHYR_SCAN_AGGREGATOR_INVALID_INDEX;
+    }
+    aggregator->lru_head = BLECON_ZEPHYR_SCAN_AGGREGATOR_INVALID_INDEX;
+    aggregator->lru_tail = BLECON_ZEPHYR_SCAN_AGGREGATOR_INVALID_INDEX;
+}
+
+void blecon_zephyr_scan_aggregator_add(struct blecon_zephyr_scan_aggregator_t* aggregator, const struct blecon_modem_raw_scan_report_t* report) {
+    size_t bucket = blecon_zephyr_scan_aggregator_bucket(&report->bt_addr, report->sid);
+
+    // Look for an existing record
+    uint16_t idx = aggregator->buckets[bucket];
+    while(idx != BLECON_ZEPHYR_SCAN_AGGREGATOR_INVALID_INDEX) {
+        struct blecon_zephyr_scan_aggregator_record_t* record = &aggregator->records[idx];
+        if((record->sid == report->sid) && blecon_bluetooth_addr_eq(record->bt_addr, report->bt_addr)) {
+            break;
+        }
+        idx = record->bucket_next;
+    }
+
+    if(idx == BLECON_ZEPHYR_SCAN_AGGREGATOR_INVALID_INDEX) {
+        if(aggregator->records_count < CONFIG_BLECON_SCAN_AGGREGATOR_MAX_DEVICES) {
+            idx = aggregator->records_count;
+            aggregator->records_count++;
+        } else {
+            // Full, report and evict the least recently seen device
+            idx = aggregator->lru_tail;
+            blecon_zephyr_scan_aggregator_report(aggregator, &aggregator->records[idx]);
+            blecon_zephyr_scan_aggregator_lru_unlink(aggregator, idx);
+            blecon_zephyr_scan_aggregator_bucket_unlink(aggregator, idx);
+        }
+
+        struct blecon_zephyr_scan_aggregator_record_t* record = &aggregator->records[idx];
+        memset(record, 0, sizeof(struct blecon_zephyr_scan_aggregator_record_t));
+        record->bt_addr = report->bt_addr;
+        record->sid = report->sid;
+        record->rssi_min = report->rssi;
+        record->rssi_max = report->rssi;
+
+        record->bucket_next = aggregator->buckets[bucket];
+        aggregator->buckets[bucket] = idx;
+    } else {
+        blecon_zephyr_scan_aggregator_lru_unlink(aggregator, idx);
+    }
+    blecon_zephyr_scan_aggregator_lru_push(aggregator, idx);
+
+    struct blecon_zephyr_scan_aggregator_record_t* record = &aggregator->records[idx];
+    record->count++;
+    record->rssi_sum += report->rssi;
+    if(report->rssi < record->rssi_min) {
+        record->rssi_min = report->rssi;
+    }
+    if(report->rssi > record->rssi_max) {
+        record->rssi_max = report->rssi;
+    }
+    record->tx_power = report->tx_power;
+
+    // Scan responses share the advert's key but carry a different payload
+    if(!report->is_scan_response) {
+        record->adv_data_hash = blecon_zephyr_scan_aggregator_fnv1a(FNV1A_32_OFFSET_BASIS, report->adv_data, report->adv_data_sz);
+    }
+}
+
+void blecon_zephyr_scan_aggregator_flush(struct blecon_zephyr_scan_aggregator_t* aggregator) {
+    // Report from the least recently seen device
+    uint16_t idx = aggregator->lru_tail;
+    while(idx != BLECON_ZEPHYR_SCAN_AGGREGATOR_INVALID_INDEX) {
+        blecon_zephyr_scan_aggregator_report(aggregator, &aggregator->records[idx]);
+        idx = aggregator->records[idx].lru_prev;
+    }
+
+    blecon_zephyr_scan_aggregator_init(aggregator, aggregator->callbacks, aggregator->user_data);
+}
+
+size_t blecon_zephyr_scan_aggregator_get_count(struct blecon_zephyr_scan_aggregator_t* aggregator) {
+    return aggregator->records_count;
+}
+
+void* blecon_zephyr_scan_aggregator_get_user_data(struct blecon_zephyr_scan_aggregator_t* aggregator) {
+    return aggregator->user_data;
+}
+
+uint32_t blecon_zephyr_scan_aggregator_fnv1a(uint32_t hash, const uint8_t* data, size_t sz) {
+    for(size_t p = 0; p < sz; p++) {
+        hash ^= data[p];
+        hash *= FNV1A_32_PRIME;
+    }
+    return hash;
+}
+
+size_t blecon_zephyr_scan_aggregator_bucket(const struct blecon_bluetooth_addr_t* bt_addr, uint8_t sid) {
+    uint32_t hash = blecon_zephyr_scan_aggregator_fnv1a(FNV1A_32_OFFSET_BASIS, bt_addr->bytes, BLECON_BLUETOOTH_ADDR_SZ);
+    hash = blecon_zephyr_scan_aggregator_fnv1a(hash, &bt_addr->addr_type, 1);
+    hash = blecon_zephyr_scan_aggregator_fnv1a(hash, &sid, 1);
+    return hash % CONFIG_BLECON_SCAN_AGGREGATOR_MAX_DEVICES;
+}
+
+void blecon_zephyr_scan_aggregator_report(struct blecon_zephyr_scan_aggregator_t* aggregator, const struct blecon_zephyr_scan_aggregator_record_t* record) {
+    struct blecon_zephyr_scan_aggregator_record_t reported = *record;
+    reported.rssi_mean = (int8_t)(reported.rssi_sum / (int32_t)reported.count);
+    aggregator->callbacks->on_record(aggregator, &reported);
+}
+
+void blecon_zephyr_scan_aggregator_lru_unlink(struct blecon_zephyr_scan_aggregator_t* aggregator, uint16_t idx) {
+    struct blecon_zephyr_scan_aggregator_record_t* record = &aggregator->records[idx];
+
+    if(record->lru_prev != BLECON_ZEPHYR_SCAN_AGGREGATOR_INVALID_INDEX) {
+        aggregator->records[record->lru_prev].lru_next = record->lru_next;
+    } else {
+        aggregator->lru_head = record->lru_next;
+    }
+
+    if(record->lru_next != BLECON_ZEPHYR_SCAN_AGGREGATOR_INVALID_INDEX) {
+        aggregator->records[record->lru_next].lru_prev = record->lru_prev;
+    } else {
+        aggregator->lru_tail = record->lru_prev;
+    }
+}
+
+void blecon_zephyr_scan_aggregator_lru_push(struct blecon_zephyr_scan_aggregator_t* aggregator, uint16_t idx) {
+    struct blecon_zephyr_scan_aggregator_record_t* record = &aggregator->records[idx];
+
+    record->lru_prev = BLECON_ZEPHYR_SCAN_AGGREGATOR_INVALID_INDEX;
+    record->lru_next = aggregator->lru_head;
+    if(aggregator->lru_head != BLECON_ZEPHYR_SCAN_AGGREGATOR_INVALID_INDEX) {
+        aggregator->records[aggregator->lru_head].lru_prev = idx;
+    } else {
+        aggregator->lru_tail = idx;
+    }
+    aggregator->lru_head = idx;
+}
+
+void blecon_zephyr_scan_aggregator_bucket_unlink(struct blecon_zephyr_scan_aggregator_t* aggregator, uint16_t idx) {
+    struct blecon_zephyr_scan_aggregator_record_t* record = &aggregator->records[idx];
+    uint16_t* link = &aggregator->buckets[blecon_zephyr_scan_aggregator_bucket(&record->bt_addr, record->sid)];
+
+    while(*link != idx) {
+        blecon_assert(*link != BLECON_ZEPHYR_SCAN_AGGREGATOR_INVALID_INDEX);
+        link = &aggregator->records[*link].bucket_next;
+    }
+    *link = record->bucket_next;
+}
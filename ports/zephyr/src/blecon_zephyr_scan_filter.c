@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) Blecon Ltd
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "string.h"
+
+#include "blecon/blecon_defs.h"
+
+#include "blecon_zephyr_scan_filter.h"
+
+// AD types
+#define AD_TYPE_UUID16_SOME     0x02
+#define AD_TYPE_UUID16_ALL      0x03
+#define AD_TYPE_SVC_DATA16      0x16
+#define AD_TYPE_MANUFACTURER    0xFF
+
+static bool blecon_zephyr_scan_filter_match_addr(const struct blecon_zephyr_scan_filter_t* filter, const struct blecon_bluetooth_addr_t* bt_addr);
+static bool blecon_zephyr_scan_filter_match_ad(const struct blecon_zephyr_scan_filter_t* filter, uint8_t type, const uint8_t* value, size_t value_sz);
+static bool blecon_zephyr_scan_filter_match_uuid16(const struct blecon_zephyr_scan_filter_t* filter, uint16_t uuid);
+
+bool blecon_zephyr_scan_filter_match(const struct blecon_zephyr_scan_filter_t* filter, const struct blecon_bluetooth_addr_t* bt_addr,
+    int8_t rssi, const uint8_t* data, size_t data_sz) {
+    bool is_blecon = false;
+    bool content_match = false;
+    bool content_filter = (filter->ad_types_count > 0) || (filter->service_uuids_count > 0) || (filter->manufacturer_data_count > 0);
+
+    // Walk AD structures
+    size_t pos = 0;
+    while(pos + 2 <= data_sz) {
+        size_t len = data[pos];
+        if((len == 0) || (pos + 1 + len > data_sz)) {
+            break; // Padding or malformed
+        }
+        uint8_t type = data[pos + 1];
+        const uint8_t* value = &data[pos + 2];
+        size_t value_sz = len - 1;
+
+        if(((type == AD_TYPE_UUID16_SOME) || (type == AD_TYPE_UUID16_ALL) || (type == AD_TYPE_SVC_DATA16))
+            && (value_sz >= 2) && ((value[0] | (value[1] << 8)) == BLECON_BLUETOOTH_SERVICE_16UUID_VAL)) {
+            is_blecon = true;
+        }
+
+        if(content_filter && !content_match) {
+            content_match = blecon_zephyr_scan_filter_match_ad(filter, type, value, value_sz);
+        }
+
+        pos += 1 + len;
+    }
+
+    // Always keep Blecon adverts so that peer scans still work
+    if(is_blecon) {
+        return true;
+    }
+
+    if(rssi < filter->min_rssi) {
+        return false;
+    }
+
+    if((filter->addrs_count > 0) && (blecon_zephyr_scan_filter_match_addr(filter, bt_addr) == filter->addrs_deny)) {
+        return false;
+    }
+
+    return !content_filter || content_match;
+}
+
+bool blecon_zephyr_scan_filter_match_addr(const struct blecon_zephyr_scan_filter_t* filter, const struct blecon_bluetooth_addr_t* bt_addr) {
+    for(size_t p = 0; p < filter->addrs_count; p++) {
+        if(blecon_bluetooth_addr_eq(filter->addrs[p], *bt_addr)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool blecon_zephyr_scan_filter_match_ad(const struct blecon_zephyr_scan_filter_t* filter, uint8_t type, const uint8_t* value, size_t value_sz) {
+    for(size_t p = 0; p < filter->ad_types_count; p++) {
+        if(filter->ad_types[p] == type) {
+            return true;
+        }
+    }
+
+    switch(type) {
+        case AD_TYPE_UUID16_SOME:
+        case AD_TYPE_UUID16_ALL:
+            for(size_t p = 0; p + 2 <= value_sz; p += 2) {
+                if(blecon_zephyr_scan_filter_match_uuid16(filter, value[p] | (value[p + 1] << 8))) {
+                    return true;
+                }
+            }
+            break;
+        case AD_TYPE_SVC_DATA16:
+            if((value_sz >= 2) && blecon_zephyr_scan_filter_match_uuid16(filter, value[0] | (value[1] << 8))) {
+                return true;
+            }
+            break;
+        case AD_TYPE_MANUFACTURER:
+            for(size_t p = 0; p < filter->manufacturer_data_count; p++) {
+                const struct blecon_zephyr_scan_filter_manufacturer_data_t* manufacturer_data = &filter->manufacturer_data[p];
+                if((value_sz >= manufacturer_data->prefix_sz) && (memcmp(value, manufacturer_data->prefix, manufacturer_data->prefix_sz) == 0)) {
+                    return true;
+                }
+            }
+            break;
+        default:
+            break;
+    }
+
+    return false;
+}
+
+bool blecon_zephyr_scan_filter_match_uuid16(const struct blecon_zephyr_scan_filter_t* filter, uint16_t uuid) {
+    for(size_t p = 0; p < filter->service_uuids_count; p++) {
+        if(filter->service_uuids[p] == uuid) {
+            return true;
+        }
+    }
+    return false;
+}
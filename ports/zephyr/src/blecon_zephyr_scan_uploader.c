@@ -0,0 +1,227 @@
+/*
+ * Copyright (c) Blecon Ltd
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/util.h>
+
+#include "string.h"
+
+#include "blecon/blecon.h"
+#include "blecon/blecon_error.h"
+#include "blecon/blecon_request.h"
+
+#include "blecon_zephyr_request_writer.h"
+#include "blecon_zephyr_scan_uploader.h"
+
+static bool blecon_zephyr_scan_uploader_write_record(struct blecon_zephyr_scan_uploader_t* uploader, const uint8_t* record, size_t sz);
+static void blecon_zephyr_scan_uploader_start_batch(struct blecon_zephyr_scan_uploader_batch_t* batch);
+static void blecon_zephyr_scan_uploader_close_batch(struct blecon_zephyr_scan_uploader_t* uploader);
+
+// Request callbacks
+static void blecon_zephyr_scan_uploader_request_on_closed(struct blecon_request_t* request);
+
+const static struct blecon_request_callbacks_t request_callbacks = {
+    .on_closed = blecon_zephyr_scan_uploader_request_on_closed,
+    .on_data_sent = NULL, // Handled by the writer
+    .alloc_incoming_data_buffer = NULL,
+    .on_data_received = NULL
+};
+
+const static struct blecon_zephyr_request_writer_callbacks_t writer_callbacks = {
+    .on_read = NULL, // Records are pushed as they are added
+    .on_done = NULL // Completion is reported when the request is closed
+};
+
+void blecon_zephyr_scan_uploader_init(struct blecon_zephyr_scan_uploader_t* uploader, struct blecon_t* blecon,
+    const char* request_namespace, const char* request_method,
+    uint8_t* buffer, size_t buffer_sz, size_t chunk_sz, size_t batch_sz,
+    const struct blecon_zephyr_scan_uploader_callbacks_t* callbacks, void* user_data) {
+    size_t batch_buffer_sz = buffer_sz / 2;
+    blecon_assert(batch_buffer_sz > BLECON_ZEPHYR_SCAN_UPLOADER_HEADER_SZ);
+    blecon_assert(batch_sz > 0);
+
+    memset(uploader, 0, sizeof(struct blecon_zephyr_scan_uploader_t));
+    uploader->blecon = blecon;
+    uploader->callbacks = callbacks;
+    uploader->user_data = user_data;
+    uploader->batch_sz = batch_sz;
+    uploader->current_batch = 0;
+
+    for(size_t p = 0; p < 2; p++) {
+        struct blecon_zephyr_scan_uploader_batch_t* batch = &uploader->batches[p];
+        batch->uploader = uploader;
+
+        const struct blecon_request_parameters_t request_parameters = {
+            .oneway = true,
+            .namespace = request_namespace,
+            .method = request_method,
+            .request_content_type = NULL,
+            .response_content_type = NULL,
+            .response_mtu = 0,
+            .callbacks = &request_callbacks,
+            .user_data = batch
+        };
+
+        // The writer keeps its own copy of the parameters
+        blecon_zephyr_request_writer_init(&batch->writer, &batch->request, &request_parameters,
+            buffer + p * batch_buffer_sz, batch_buffer_sz, chunk_sz, &writer_callbacks, batch);
+    }
+}
+
+bool blecon_zephyr_scan_uploader_add_peer_report(struct blecon_zephyr_scan_uploader_t* uploader, const struct blecon_modem_peer_scan_report_t* report) {
+    uint8_t record[1 + BLECON_UUID_SZ + 3];
+    record[0] = BLECON_ZEPHYR_SCAN_UPLOADER_RECORD_PEER;
+    memcpy(&record[1], report->blecon_id, BLECON_UUID_SZ);
+    record[1 + BLECON_UUID_SZ] = report->is_announcing ? 0x01 : 0x00;
+    record[1 + BLECON_UUID_SZ + 1] = (uint8_t)report->tx_power;
+    record[1 + BLECON_UUID_SZ + 2] = (uint8_t)report->rssi;
+
+    return blecon_zephyr_scan_uploader_write_record(uploader, record, sizeof(record));
+}
+
+bool blecon_zephyr_scan_uploader_add_raw_report(struct blecon_zephyr_scan_uploader_t* uploader, const struct blecon_modem_raw_scan_report_t* report) {
+    uint8_t record[BLECON_ZEPHYR_SCAN_UPLOADER_MAX_RECORD_SZ];
+    size_t adv_data_sz = MIN(report->adv_data_sz, 255);
+
+    size_t pos = 0;
+    record[pos++] = BLECON_ZEPHYR_SCAN_UPLOADER_RECORD_RAW;
+    memcpy(&record[pos], report->bt_addr.bytes, BLECON_BLUETOOTH_ADDR_SZ);
+    pos += BLECON_BLUETOOTH_ADDR_SZ;
+    record[pos++] = report->bt_addr.addr_type;
+    record[pos++] = (report->sid & 0x0F) | (report->is_scan_response ? 0x10 : 0x00) | ((report->adv_data_sz > adv_data_sz) ? 0x20 : 0x00);
+    record[pos++] = (uint8_t)report->tx_power;
+    record[pos++] = (uint8_t)report->rssi;
+    record[pos++] = (uint8_t)adv_data_sz;
+    memcpy(&record[pos], report->adv_data, adv_data_sz);
+    pos += adv_data_sz;
+
+    return blecon_zephyr_scan_uploader_write_record(uploader, record, pos);
+}
+
+#if defined(CONFIG_BLECON_SCAN_AGGREGATOR)
+bool blecon_zephyr_scan_uploader_add_aggregated_record(struct blecon_zephyr_scan_uploader_t* uploader, const struct blecon_zephyr_scan_aggregator_record_t* record) {
+    uint8_t data[1 + BLECON_BLUETOOTH_ADDR_SZ + 1 + 1 + 1 + 3 + 2 + 4];
+
+    size_t pos = 0;
+    data[pos++] = BLECON_ZEPHYR_SCAN_UPLOADER_RECORD_AGGREGATED;
+    memcpy(&data[pos], record->bt_addr.bytes, BLECON_BLUETOOTH_ADDR_SZ);
+    pos += BLECON_BLUETOOTH_ADDR_SZ;
+    data[pos++] = record->bt_addr.addr_type;
+    data[pos++] = record->sid;
+    data[pos++] = (uint8_t)record->tx_power;
+    data[pos++] = (uint8_t)record->rssi_min;
+    data[pos++] = (uint8_t)record->rssi_max;
+    data[pos++] = (uint8_t)record->rssi_mean;
+    sys_put_le16(MIN(record->count, UINT16_MAX), &data[pos]);
+    pos += 2;
+    sys_put_le32(record->adv_data_hash, &data[pos]);
+    pos += 4;
+
+    return blecon_zephyr_scan_uploader_write_record(uploader, data, pos);
+}
+#endif
+
+void blecon_zephyr_scan_uploader_peer_scan_report_iterator(const struct blecon_modem_peer_scan_report_t* report, void* user_data) {
+    blecon_zephyr_scan_uploader_add_peer_report((struct blecon_zephyr_scan_uploader_t*)user_data, report);
+}
+
+void blecon_zephyr_scan_uploader_raw_scan_report_iterator(const struct blecon_modem_raw_scan_report_t* report, void* user_data) {
+    blecon_zephyr_scan_uploader_add_raw_report((struct blecon_zephyr_scan_uploader_t*)user_data, report);
+}
+
+void blecon_zephyr_scan_uploader_flush(struct blecon_zephyr_scan_uploader_t* uploader) {
+    struct blecon_zephyr_scan_uploader_batch_t* batch = &uploader->batches[uploader->current_batch];
+    if(!batch->in_progress || batch->closed) {
+        return;
+    }
+    blecon_zephyr_scan_uploader_close_batch(uploader);
+}
+
+uint32_t blecon_zephyr_scan_uploader_get_dropped_count(struct blecon_zephyr_scan_uploader_t* uploader) {
+    return uploader->dropped_count;
+}
+
+void* blecon_zephyr_scan_uploader_get_user_data(struct blecon_zephyr_scan_uploader_t* uploader) {
+    return uploader->user_data;
+}
+
+bool blecon_zephyr_scan_uploader_write_record(struct blecon_zephyr_scan_uploader_t* uploader, const uint8_t* record, size_t sz) {
+    struct blecon_zephyr_scan_uploader_batch_t* batch = &uploader->batches[uploader->current_batch];
+
+    if(!batch->in_progress) {
+        if(!blecon_is_connected(uploader->blecon)) {
+            uploader->dropped_count++;
+
+            // Only notify once until a batch can be started again
+            if(!uploader->connection_required_notified) {
+                uploader->connection_required_notified = true;
+                if(uploader->callbacks->on_connection_required != NULL) {
+                    uploader->callbacks->on_connection_required(uploader);
+                }
+            }
+            return false;
+        }
+        blecon_zephyr_scan_uploader_start_batch(batch);
+    }
+
+    // Only write whole records; the other batch's request may still be closing
+    if(batch->closed || (blecon_zephyr_request_writer_get_free_space(&batch->writer) < sz)) {
+        uploader->dropped_count++;
+        return false;
+    }
+
+    size_t written = blecon_zephyr_request_writer_write(&batch->writer, record, sz);
+    blecon_assert(written == sz);
+    batch->sz += sz;
+
+    if(batch->sz >= uploader->batch_sz) {
+        blecon_zephyr_scan_uploader_close_batch(uploader);
+    }
+
+    return true;
+}
+
+void blecon_zephyr_scan_uploader_start_batch(struct blecon_zephyr_scan_uploader_batch_t* batch) {
+    uint8_t header[BLECON_ZEPHYR_SCAN_UPLOADER_HEADER_SZ];
+    header[0] = BLECON_ZEPHYR_SCAN_UPLOADER_FORMAT_VERSION;
+    sys_put_le32(k_uptime_get_32(), &header[1]);
+
+    batch->in_progress = true;
+    batch->closed = false;
+    batch->uploader->connection_required_notified = false;
+
+    blecon_request_cleanup(&batch->request);
+    blecon_zephyr_request_writer_start(&batch->writer);
+    size_t written = blecon_zephyr_request_writer_write(&batch->writer, header, sizeof(header));
+    blecon_assert(written == sizeof(header));
+    batch->sz = written;
+
+    blecon_submit_request(batch->uploader->blecon, &batch->request);
+}
+
+void blecon_zephyr_scan_uploader_close_batch(struct blecon_zephyr_scan_uploader_t* uploader) {
+    struct blecon_zephyr_scan_uploader_batch_t* batch = &uploader->batches[uploader->current_batch];
+    batch->closed = true;
+    blecon_zephyr_request_writer_close(&batch->writer);
+
+    // Write subsequent records to the other batch
+    uploader->current_batch = (uploader->current_batch + 1) % 2;
+}
+
+void blecon_zephyr_scan_uploader_request_on_closed(struct blecon_request_t* request) {
+    struct blecon_zephyr_scan_uploader_batch_t* batch = (struct blecon_zephyr_scan_uploader_batch_t*)blecon_request_get_parameters(request)->user_data;
+    struct blecon_zephyr_scan_uploader_t* uploader = batch->uploader;
+    bool success = batch->closed && (blecon_request_get_status(request) == blecon_request_status_ok);
+
+    // A batch closed early (e.g. on disconnection) is restarted when the next record is added
+    batch->in_progress = false;
+    batch->closed = false;
+    batch->sz = 0;
+
+    if(uploader->callbacks->on_batch_done != NULL) {
+        uploader->callbacks->on_batch_done(uploader, success);
+    }
+}
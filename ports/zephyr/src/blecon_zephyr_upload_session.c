@@ -0,0 +1,212 @@
+/*
+ * Copyright (c) Blecon Ltd
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/util.h>
+
+#include "string.h"
+
+#include "blecon/blecon.h"
+#include "blecon/blecon_error.h"
+#include "blecon/blecon_request.h"
+
+#include "blecon_zephyr_request_writer.h"
+#include "blecon_zephyr_upload_session.h"
+
+static void blecon_zephyr_upload_session_send_segment(struct blecon_zephyr_upload_session_t* session);
+static void blecon_zephyr_upload_session_fail(struct blecon_zephyr_upload_session_t* session);
+
+// Request callbacks
+static void blecon_zephyr_upload_session_request_on_closed(struct blecon_request_t* request);
+
+// Writer callbacks
+static size_t blecon_zephyr_upload_session_writer_on_read(struct blecon_zephyr_request_writer_t* writer, uint8_t* data, size_t max_sz, bool* finished);
+static void blecon_zephyr_upload_session_writer_on_done(struct blecon_zephyr_request_writer_t* writer, bool success);
+
+// Event
+static void blecon_zephyr_upload_session_next_segment_event(struct blecon_event_t* event, void* user_data);
+
+const static struct blecon_request_callbacks_t request_callbacks = {
+    .on_closed = blecon_zephyr_upload_session_request_on_closed,
+    .on_data_sent = NULL, // Handled by the writer
+    .alloc_incoming_data_buffer = NULL,
+    .on_data_received = NULL
+};
+
+const static struct blecon_zephyr_request_writer_callbacks_t writer_callbacks = {
+    .on_read = blecon_zephyr_upload_session_writer_on_read,
+    .on_done = blecon_zephyr_upload_session_writer_on_done
+};
+
+void blecon_zephyr_upload_session_init(struct blecon_zephyr_upload_session_t* session, struct blecon_event_loop_t* event_loop, struct blecon_t* blecon,
+    const char* request_namespace, const char* request_method,
+    uint8_t* buffer, size_t buffer_sz, size_t chunk_sz, size_t segment_sz,
+    const struct blecon_zephyr_upload_session_callbacks_t* callbacks, void* user_data) {
+    blecon_assert(segment_sz > 0);
+
+    memset(session, 0, sizeof(struct blecon_zephyr_upload_session_t));
+    session->blecon = blecon;
+    session->callbacks = callbacks;
+    session->user_data = user_data;
+    session->segment_sz = segment_sz;
+
+    const struct blecon_request_parameters_t request_parameters = {
+        .oneway = true,
+        .namespace = request_namespace,
+        .method = request_method,
+        .request_content_type = NULL,
+        .response_content_type = NULL,
+        .response_mtu = 0,
+        .callbacks = &request_callbacks,
+        .user_data = session
+    };
+
+    // The writer keeps its own copy of the parameters
+    blecon_zephyr_request_writer_init(&session->writer, &session->request, &request_parameters,
+        buffer, buffer_sz, chunk_sz, &writer_callbacks, session);
+
+    session->next_segment_event = blecon_event_loop_register_event(event_loop, blecon_zephyr_upload_session_next_segment_event, session);
+}
+
+void blecon_zephyr_upload_session_start(struct blecon_zephyr_upload_session_t* session, const uint8_t* session_id, size_t total_sz, size_t offset) {
+    blecon_assert(!session->uploading);
+    blecon_assert(offset <= total_sz);
+
+    memcpy(session->session_id, session_id, BLECON_UUID_SZ);
+    session->total_sz = total_sz;
+    session->acknowledged_offset = offset;
+
+    blecon_zephyr_upload_session_resume(session);
+}
+
+void blecon_zephyr_upload_session_resume(struct blecon_zephyr_upload_session_t* session) {
+    if(session->uploading) {
+        return;
+    }
+    session->uploading = true;
+
+    // Submit from the event loop, so that this is safe to call from callbacks
+    blecon_event_signal(session->next_segment_event);
+}
+
+void blecon_zephyr_upload_session_data_available(struct blecon_zephyr_upload_session_t* session) {
+    if(!session->uploading) {
+        return;
+    }
+    blecon_zephyr_request_writer_data_available(&session->writer);
+}
+
+size_t blecon_zephyr_upload_session_get_acknowledged_offset(struct blecon_zephyr_upload_session_t* session) {
+    return session->acknowledged_offset;
+}
+
+void* blecon_zephyr_upload_session_get_user_data(struct blecon_zephyr_upload_session_t* session) {
+    return session->user_data;
+}
+
+void blecon_zephyr_upload_session_send_segment(struct blecon_zephyr_upload_session_t* session) {
+    if(!session->uploading || session->request_open) {
+        // The request is sent again once the previous one has closed
+        return;
+    }
+
+    if(session->acknowledged_offset >= session->total_sz) {
+        session->uploading = false;
+        if(session->callbacks->on_done != NULL) {
+            session->callbacks->on_done(session, true);
+        }
+        return;
+    }
+
+    session->read_offset = session->acknowledged_offset;
+    session->segment_end = session->acknowledged_offset + MIN(session->segment_sz, session->total_sz - session->acknowledged_offset);
+
+    // Build header
+    uint8_t* header = session->header;
+    header[0] = BLECON_ZEPHYR_UPLOAD_SESSION_HEADER_VERSION;
+    memcpy(&header[1], session->session_id, BLECON_UUID_SZ);
+    sys_put_le32(session->acknowledged_offset, &header[1 + BLECON_UUID_SZ]);
+    sys_put_le32(session->total_sz, &header[1 + BLECON_UUID_SZ + 4]);
+    session->header_pos = 0;
+
+    blecon_request_cleanup(&session->request);
+    session->request_open = true;
+    session->segment_failed = false;
+    blecon_zephyr_request_writer_start(&session->writer);
+    blecon_submit_request(session->blecon, &session->request);
+}
+
+void blecon_zephyr_upload_session_fail(struct blecon_zephyr_upload_session_t* session) {
+    // Can be resumed from the last acknowledged segment
+    session->uploading = false;
+    if(session->callbacks->on_done != NULL) {
+        session->callbacks->on_done(session, false);
+    }
+}
+
+void blecon_zephyr_upload_session_request_on_closed(struct blecon_request_t* request) {
+    struct blecon_zephyr_upload_session_t* session = (struct blecon_zephyr_upload_session_t*)blecon_request_get_parameters(request)->user_data;
+    session->request_open = false;
+
+    if(session->segment_failed) {
+        // Already reported by the writer; the upload may have been resumed since
+        session->segment_failed = false;
+        blecon_event_signal(session->next_segment_event);
+        return;
+    }
+
+    if(blecon_request_get_status(request) != blecon_request_status_ok) {
+        blecon_zephyr_upload_session_fail(session);
+        return;
+    }
+
+    session->acknowledged_offset = session->segment_end;
+    if(session->callbacks->on_progress != NULL) {
+        session->callbacks->on_progress(session, session->acknowledged_offset);
+    }
+
+    // The next segment reuses this request, so it is submitted once this callback has returned
+    blecon_event_signal(session->next_segment_event);
+}
+
+size_t blecon_zephyr_upload_session_writer_on_read(struct blecon_zephyr_request_writer_t* writer, uint8_t* data, size_t max_sz, bool* finished) {
+    struct blecon_zephyr_upload_session_t* session = (struct blecon_zephyr_upload_session_t*)blecon_zephyr_request_writer_get_user_data(writer);
+    size_t sz = 0;
+
+    // Header first
+    if(session->header_pos < sizeof(session->header)) {
+        size_t header_sz = MIN(sizeof(session->header) - session->header_pos, max_sz);
+        memcpy(data, session->header + session->header_pos, header_sz);
+        session->header_pos += header_sz;
+        sz += header_sz;
+    }
+
+    if((session->header_pos == sizeof(session->header)) && (sz < max_sz) && (session->read_offset < session->segment_end)) {
+        size_t read_sz = session->callbacks->on_read(session, session->read_offset, data + sz,
+            MIN(max_sz - sz, session->segment_end - session->read_offset));
+        session->read_offset += read_sz;
+        sz += read_sz;
+    }
+
+    *finished = (session->header_pos == sizeof(session->header)) && (session->read_offset == session->segment_end);
+    return sz;
+}
+
+void blecon_zephyr_upload_session_writer_on_done(struct blecon_zephyr_request_writer_t* writer, bool success) {
+    struct blecon_zephyr_upload_session_t* session = (struct blecon_zephyr_upload_session_t*)blecon_zephyr_request_writer_get_user_data(writer);
+    if(success || !session->uploading) {
+        // Success is reported when the request is closed
+        return;
+    }
+
+    // Sending data failed
+    session->segment_failed = true;
+    blecon_zephyr_upload_session_fail(session);
+}
+
+void blecon_zephyr_upload_session_next_segment_event(struct blecon_event_t* event, void* user_data) {
+    struct blecon_zephyr_upload_session_t* session = (struct blecon_zephyr_upload_session_t*)user_data;
+    blecon_zephyr_upload_session_send_segment(session);
+}